@@ -1,22 +1,33 @@
 #include "app/fractal_app.h"
 
 #include "app/ui/fractal_window.h"
-#include "render/cpu/cpu_renderer.h"
+#include "render/cpu/gl_cpu_renderer.h"
 
 #ifdef HAVE_CUDA
 #include "render/cuda/cuda_renderer.h"
 #include "render/cuda/utils.h"
 #endif
 
+namespace {
+
+// Interactive views trade the rare pixel subdivision gets wrong for speed.
+render::CPURendererOptions InteractiveOptions() {
+  render::CPURendererOptions options;
+  options.subdivision = render::Subdivision2D::kOn;
+  return options;
+}
+
+}  // namespace
+
 FractalApp::FractalApp() {
 #ifdef HAVE_CUDA
   if (IsCUDASupported()) {
     renderer_ = std::make_unique<render::CUDARenderer>();
   } else {
-    renderer_ = std::make_unique<render::CPURenderer>();
+    renderer_ = std::make_unique<render::GLCPURenderer>(InteractiveOptions());
   }
 #else
-  renderer_ = std::make_unique<render::CPURenderer>();
+  renderer_ = std::make_unique<render::GLCPURenderer>(InteractiveOptions());
 #endif
 
   renderer_->SetSettingsProvider(&settings_);
@@ -1,10 +1,17 @@
 #include "app/settings_manager.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
 #include "render/common/fractals.h"
 
 namespace {
 
 constexpr Vector3d kWorldUp{0.0f, 0.0f, 1.0f};
+// 2D zoom moves between scales 2^(-1/8) apart, so a view zoomed out again
+// lands on the scale of tiles the renderer cached before.
+constexpr double kZoomLevelsPerOctave = 8.0;
 
 Vector3d RotateAroundAxis(const Vector3d& v, const Vector3d& axis,
                           float angle) {
@@ -27,12 +34,55 @@ void SettingsManager::Zoom(float factor) {
     return;
   }
 
-  pending_.camera.scale /= factor;
+  if (render::Is2DFractal(pending_.fractal.type)) {
+    auto& view = pending_.view2d;
+    zoom_ += std::log2(factor) * kZoomLevelsPerOctave;
+    const double steps = std::trunc(zoom_);
+    zoom_ -= steps;
+    const double level = zoom_level_ + steps;
+    const double scale = render::View2DSettings{}.scale *
+                         std::exp2(-level / kZoomLevelsPerOctave);
+    if (steps != 0.0 && scale >= view.kMinScale) {
+      zoom_level_ += static_cast<int32_t>(steps);
+      view.scale = scale;
+    }
+    pending_.camera.scale = std::max(view.scale, static_cast<double>(FLT_MIN));
+  } else {
+    pending_.camera.scale /= factor;
+  }
 
   need_commit_ = true;
 }
 
 void SettingsManager::Move(float x, float y, float z) {
+  if (render::Is2DFractal(pending_.fractal.type)) {
+    // Pan in FixedPoint so steps far below float precision still add up.
+    auto& view = pending_.view2d;
+    double dx = x * view.scale;
+    double dy = y * view.scale;
+    if (width_ > 0 && height_ > 0) {
+      // Move by whole pixels and carry the rest over to the next pan, so the
+      // renderer can shift the last frame instead of redrawing it.
+      const double pixel_x = 2.0 * pending_.camera.aspect * view.scale / width_;
+      const double pixel_y = 2.0 * view.scale / height_;
+      pan_x_ += dx / pixel_x;
+      pan_y_ += dy / pixel_y;
+      const double steps_x = std::trunc(pan_x_);
+      const double steps_y = std::trunc(pan_y_);
+      pan_x_ -= steps_x;
+      pan_y_ -= steps_y;
+      dx = steps_x * pixel_x;
+      dy = steps_y * pixel_y;
+    }
+    view.center_x += render::FixedPoint::FromDouble(dx);
+    view.center_y += render::FixedPoint::FromDouble(dy);
+    pending_.camera.position.x = view.center_x.ToDouble();
+    pending_.camera.position.y = view.center_y.ToDouble();
+
+    need_commit_ = true;
+    return;
+  }
+
   const float dx = x * pending_.camera.scale;
   const float dy = y * pending_.camera.scale;
   const float dz = z * pending_.camera.scale;
@@ -77,15 +127,23 @@ void SettingsManager::Resize(uint32_t w, uint32_t h) {
   if (w == 0 || h == 0) return;
 
   pending_.camera.aspect = static_cast<float>(w) / h;
+  width_ = w;
+  height_ = h;
 
   need_commit_ = true;
 }
 
 void SettingsManager::SetFractalType(uint8_t type) {
   const auto current_aspect = pending_.camera.aspect;
+  const auto heatmap = pending_.heatmap;
   pending_ = render::RenderSettings{};
   pending_.fractal.type = render::FractalType(type);
   pending_.camera.aspect = current_aspect;
+  pending_.heatmap = heatmap;
+  pan_x_ = 0.0;
+  pan_y_ = 0.0;
+  zoom_ = 0.0;
+  zoom_level_ = 0;
   need_commit_ = true;
 }
 
@@ -114,6 +172,16 @@ void SettingsManager::SetJuliabulbParams(render::JuliabulbParams params) {
   need_commit_ = true;
 }
 
+void SettingsManager::SetDeepZoom(bool enabled) {
+  pending_.view2d.deep_zoom = enabled;
+  need_commit_ = true;
+}
+
+void SettingsManager::SetHeatmap(render::Heatmap heatmap) {
+  pending_.heatmap = heatmap;
+  need_commit_ = true;
+}
+
 void SettingsManager::Commit() {
   if (!need_commit_) {
     return;
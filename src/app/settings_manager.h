@@ -20,6 +20,10 @@ class SettingsManager : public render::SettingsProvider {
   void SetMandelbulbParams(render::MandelbulbParams params);
   void SetMandelboxParams(render::MandelboxParams params);
   void SetJuliabulbParams(render::JuliabulbParams params);
+  // Forces perturbation rendering for the Mandelbrot set.
+  void SetDeepZoom(bool enabled);
+  // Shows per-pixel cost instead of colors (CPU renderer only).
+  void SetHeatmap(render::Heatmap heatmap);
 
   void Commit();
 
@@ -31,6 +35,17 @@ class SettingsManager : public render::SettingsProvider {
   render::RenderSettings pending_;
   bool need_commit_ = false;
 
+  // View size, and the part of a 2D pan smaller than a pixel that is still
+  // to be applied.
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  double pan_x_ = 0.0;
+  double pan_y_ = 0.0;
+  // 2D zoom level of the view, and the part of a zoom smaller than a level
+  // that is still to be applied.
+  int32_t zoom_level_ = 0;
+  double zoom_ = 0.0;
+
   render::RenderSettings settings_;
 
   std::vector<std::function<void()>> observers_;
@@ -29,7 +29,7 @@ FractalWindow::FractalWindow(FractalApp* app) : app_(app) {
   connect(renderer_widget_, &RendererWidget::FrameStatsUpdated,
           settings_widget_, &SettingsWidget::SetFrameStats);
 
-  app_->settings().AddObserver([this] { renderer_widget_->update(); });
+  app_->settings().AddObserver([this] { renderer_widget_->RequestFrame(); });
   app_->settings().AddObserver(
       [this] { settings_widget_->SyncWithSettings(); });
 
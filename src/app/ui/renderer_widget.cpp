@@ -6,6 +6,7 @@
 #include "app/fractal_app.h"
 #include "app/ui/fractal_window.h"
 #include "app/ui/input_controller.h"
+#include "render/cpu/trace.h"
 
 namespace ui {
 
@@ -16,12 +17,26 @@ RendererWidget::RendererWidget(FractalWindow* parent /* = nullptr */,
 
   setFocusPolicy(Qt::StrongFocus);
   setMouseTracking(true);
+  render::Tracer::Get().SetThreadName("gui");
+
+  if (renderer_) {
+    // Called from the render thread: repaint on the GUI thread.
+    renderer_->SetFrameReadyCallback([this] {
+      QMetaObject::invokeMethod(this, [this] { update(); },
+                                Qt::QueuedConnection);
+    });
+  }
 }
 
 void RendererWidget::UpdateSettings(double dt) {
   input_controller_->Update(dt);
 }
 
+void RendererWidget::RequestFrame() {
+  frame_requested_ = true;
+  update();
+}
+
 void RendererWidget::initializeGL() {
   initializeOpenGLFunctions();
 
@@ -97,20 +112,30 @@ void RendererWidget::resizeGL(int w, int h) {
   if (renderer_) {
     renderer_->Resize(w, h);
   }
+  frame_requested_ = true;
   glViewport(0, 0, w, h);
 }
 
 void RendererWidget::paintGL() {
-  frame_timer_.restart();
-
+  // Only settings changes and resizes render; other paints redraw the last
+  // frame, so the GUI thread never waits for a slow one.
+  render::FrameStats stats;
+  bool presented = false;
   if (renderer_) {
-    renderer_->Render();
+    if (frame_requested_) {
+      frame_requested_ = false;
+      renderer_->Render();
+    }
+    presented = renderer_->Present(&stats);
+  }
+  {
+    render::TraceSpan span("draw");
+    DrawTexture();
   }
-  DrawTexture();
 
-  const double frame_ms = frame_timer_.nsecsElapsed() * 1e-6;
-  const double fps = 1000.0 / frame_ms;
-  emit FrameStatsUpdated(frame_ms, fps);
+  if (presented) {
+    emit FrameStatsUpdated(stats);
+  }
 }
 
 void RendererWidget::resizeEvent(QResizeEvent* event) {
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <QElapsedTimer>
 #include <QOpenGLFunctions_3_3_Core>
 #include <QOpenGLShaderProgram>
 #include <QtOpenGLWidgets/QOpenGLWidget>
@@ -21,10 +20,12 @@ class RendererWidget : public QOpenGLWidget,
                  render::Renderer* renderer = nullptr);
 
   void UpdateSettings(double delta_seconds);
+  // Renders a frame with the current settings at the next paint.
+  void RequestFrame();
 
  signals:
   void ViewResized(uint32_t w, uint32_t h);
-  void FrameStatsUpdated(double ms, double fps);
+  void FrameStatsUpdated(const render::FrameStats& stats);
 
  protected:
   void initializeGL() override;
@@ -50,7 +51,7 @@ class RendererWidget : public QOpenGLWidget,
   bool mouse_locked_ = false;
   bool ignore_next_mouse_event_ = false;
 
-  QElapsedTimer frame_timer_;
+  bool frame_requested_ = true;
 
   render::Renderer* renderer_;
   TextureTarget texture_;
@@ -1,17 +1,56 @@
 #include "app/ui/settings_widget.h"
 
+#include <QCheckBox>
 #include <QComboBox>
+#include <QFileDialog>
 #include <QFormLayout>
 #include <QLabel>
+#include <QPushButton>
 #include <QSpinBox>
 #include <QStackedWidget>
 #include <QVBoxLayout>
+#include <fstream>
 
 #include "app/settings_manager.h"
+#include "render/cpu/trace.h"
 #include "render/settings_provider.h"
 
 namespace {
 
+class MandelbrotSettingsWidget final : public QWidget {
+  Q_OBJECT
+ public:
+  explicit MandelbrotSettingsWidget(QWidget* parent, SettingsManager* settings)
+      : QWidget(parent), settings_(settings) {
+    auto* layout = new QFormLayout(this);
+
+    deep_zoom_ = new QCheckBox(this);
+    deep_zoom_->setToolTip(
+        "Always use perturbation rendering, which otherwise starts past "
+        "double-double precision (CPU renderer only)");
+
+    layout->addRow("Deep zoom", deep_zoom_);
+
+    connect(deep_zoom_, &QCheckBox::toggled, this,
+            &MandelbrotSettingsWidget::OnDeepZoomToggled);
+  }
+
+  void SyncFromSettings(const render::View2DSettings& view) {
+    deep_zoom_->setChecked(view.deep_zoom);
+  }
+
+ private slots:
+  void OnDeepZoomToggled(bool enabled) {
+    if (!settings_) return;
+    settings_->SetDeepZoom(enabled);
+  }
+
+ private:
+  QCheckBox* deep_zoom_;
+
+  SettingsManager* settings_;
+};
+
 class JuliaSettingsWidget final : public QWidget {
   Q_OBJECT
  public:
@@ -235,7 +274,12 @@ void SettingsWidget::SyncWithSettings() {
 
   fractal_combo_->setCurrentIndex(static_cast<int>(settings.fractal.type));
   fractal_stack_->setCurrentIndex(static_cast<int>(settings.fractal.type));
+  heatmap_combo_->setCurrentIndex(static_cast<int>(settings.heatmap));
 
+  if (auto* mandelbrot_widget = dynamic_cast<MandelbrotSettingsWidget*>(
+          fractal_stack_->currentWidget())) {
+    mandelbrot_widget->SyncFromSettings(settings.view2d);
+  }
   if (auto* julia_widget =
           dynamic_cast<JuliaSettingsWidget*>(fractal_stack_->currentWidget())) {
     julia_widget->SyncFromSettings(settings.fractal.julia);
@@ -256,8 +300,16 @@ void SettingsWidget::SyncWithSettings() {
   iterations_spin_->setValue(settings.fractal.max_iterations);
 }
 
-void SettingsWidget::SetFrameStats(double ms, double fps) {
-  fps_label_->setText(QString("Render Time: %1\nFPS: %2").arg(ms).arg(fps));
+void SettingsWidget::SetFrameStats(const render::FrameStats& stats) {
+  const double fps = 1000.0 / stats.render_ms;
+  QString text =
+      QString("Render Time: %1\nFPS: %2").arg(stats.render_ms).arg(fps);
+  if (stats.heatmap) {
+    text += QString("\nCost p50: %1\nCost p99: %2")
+                .arg(stats.cost_p50)
+                .arg(stats.cost_p99);
+  }
+  fps_label_->setText(text);
 }
 
 void SettingsWidget::BuildUI() {
@@ -286,12 +338,27 @@ void SettingsWidget::BuildUI() {
   top_form->addRow("Fractal Type", fractal_combo_);
 
   iterations_spin_ = new QSpinBox(this);
-  iterations_spin_->setRange(1, 256);
+  // Deep zooms need thousands of iterations to resolve the boundary.
+  iterations_spin_->setRange(1, 100000);
   connect(iterations_spin_, &QSpinBox::valueChanged, this,
           &SettingsWidget::OnIterationsChanged);
 
   top_form->addRow("Iterations", iterations_spin_);
 
+  heatmap_combo_ = new QComboBox(this);
+  heatmap_combo_->addItem("Off", static_cast<uint8_t>(render::Heatmap::kOff));
+  heatmap_combo_->addItem("Steps",
+                          static_cast<uint8_t>(render::Heatmap::kSteps));
+  heatmap_combo_->addItem(
+      "SDF Evaluations", static_cast<uint8_t>(render::Heatmap::kEvaluations));
+  heatmap_combo_->setToolTip(
+      "Show escape iterations, march steps or SDF evaluations per pixel "
+      "(CPU renderer only)");
+  connect(heatmap_combo_, QOverload<int>::of(&QComboBox::currentIndexChanged),
+          this, &SettingsWidget::OnHeatmapChanged);
+
+  top_form->addRow("Heatmap", heatmap_combo_);
+
   layout->addLayout(top_form);
 
   auto* separator = new QFrame(this);
@@ -301,7 +368,8 @@ void SettingsWidget::BuildUI() {
   fractal_stack_ = new QStackedWidget(this);
   layout->addWidget(fractal_stack_);
   // Mandelbrot
-  fractal_stack_->addWidget(new QWidget(this));
+  fractal_stack_->addWidget(
+      new MandelbrotSettingsWidget(this, settings_manager_));
   // Julia
   fractal_stack_->addWidget(new JuliaSettingsWidget(this, settings_manager_));
   // Menger Sponge
@@ -320,6 +388,38 @@ void SettingsWidget::BuildUI() {
 
   fps_label_ = new QLabel(this);
   layout->addWidget(fps_label_);
+
+  auto* trace_form = new QFormLayout();
+  trace_check_ = new QCheckBox(this);
+  trace_check_->setToolTip(
+      "Record per-stage spans of every frame (CPU renderer only)");
+  connect(trace_check_, &QCheckBox::toggled, this,
+          &SettingsWidget::OnTraceToggled);
+  trace_form->addRow("Record trace", trace_check_);
+  layout->addLayout(trace_form);
+
+  auto* save_trace = new QPushButton("Save Trace...", this);
+  connect(save_trace, &QPushButton::clicked, this,
+          &SettingsWidget::OnSaveTrace);
+  layout->addWidget(save_trace);
+}
+
+void SettingsWidget::OnTraceToggled(bool enabled) {
+  if (enabled) {
+    render::Tracer::Get().Start();
+  } else {
+    render::Tracer::Get().Stop();
+  }
+}
+
+void SettingsWidget::OnSaveTrace() {
+  const QString path = QFileDialog::getSaveFileName(
+      this, "Save Trace", "trace.json", "Chrome trace (*.json)");
+  if (path.isEmpty()) {
+    return;
+  }
+  std::ofstream out(path.toStdString());
+  render::Tracer::Get().WriteChromeJson(out);
 }
 
 void SettingsWidget::OnFractalTypeChanged(int index) {
@@ -329,6 +429,11 @@ void SettingsWidget::OnFractalTypeChanged(int index) {
   settings_manager_->SetFractalType(type);
 }
 
+void SettingsWidget::OnHeatmapChanged(int index) {
+  settings_manager_->SetHeatmap(
+      static_cast<render::Heatmap>(heatmap_combo_->itemData(index).toInt()));
+}
+
 void SettingsWidget::OnIterationsChanged(uint32_t value) {
   settings_manager_->SetMaxIterations(static_cast<uint32_t>(value));
 }
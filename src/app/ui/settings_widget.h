@@ -2,7 +2,10 @@
 
 #include <QWidget>
 
+#include "render/renderer.h"
+
 class SettingsManager;
+class QCheckBox;
 class QComboBox;
 class QSpinBox;
 class QStackedWidget;
@@ -16,20 +19,26 @@ class SettingsWidget : public QWidget {
   SettingsWidget(QWidget* parent, SettingsManager* settings);
 
   void SyncWithSettings();
-  void SetFrameStats(double ms, double fps);
+  void SetFrameStats(const render::FrameStats& stats);
 
  private:
   void BuildUI();
 
   void OnFractalTypeChanged(int type);
   void OnIterationsChanged(uint32_t iterations);
+  void OnHeatmapChanged(int index);
+  void OnTraceToggled(bool enabled);
+  // Writes the recorded spans as Chrome trace JSON to a file the user picks.
+  void OnSaveTrace();
 
   SettingsManager* settings_manager_;
 
   QComboBox* fractal_combo_;
   QSpinBox* iterations_spin_;
+  QComboBox* heatmap_combo_;
   QStackedWidget* fractal_stack_;
   QLabel* fps_label_;
+  QCheckBox* trace_check_;
 };
 
 }  // namespace ui
\ No newline at end of file
@@ -0,0 +1,811 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/presets.h"
+#include "bench/report.h"
+#include "render/common/utils.h"
+#include "render/cpu/cpu_features.h"
+#include "render/cpu/cpu_renderer.h"
+#include "render/cpu/escape_time.h"
+#include "render/cpu/packet_march.h"
+
+namespace {
+
+struct Resolution {
+  uint32_t width;
+  uint32_t height;
+};
+
+struct Options {
+  std::string format = "json";
+  std::string output;
+  std::string fractal;
+  std::vector<std::string> suites = {"kernels", "frames", "scaling",
+                                     "flythrough", "pan", "zoom"};
+  uint32_t repeat = 5;
+  std::vector<Resolution> resolutions = {
+      {320, 240}, {640, 480}, {1280, 720}, {1920, 1080}};
+  Resolution scaling_resolution = {640, 480};
+  uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+// Points per kernel benchmark run.
+constexpr uint32_t kKernelSide = 256;
+constexpr uint32_t kSdfPoints = 1 << 16;
+// Largest relative difference allowed between 99.9% of the trig-free and the
+// spherical-coordinate Mandelbulb distances, for distances of at least 1e-3.
+// A few points next to the surface differ by up to a few percent, as they do
+// between float and double trig: rounding there changes the escape iteration.
+constexpr float kMandelbulbTolerance = 5e-4f;
+constexpr double kDegreesPerRadian = 57.29577951308232;
+// Extra samples per edge pixel of the anti-aliased frame variants.
+constexpr uint32_t kAntialiasSamples = 4;
+// Over-relaxation factors the march benchmark compares with plain steps.
+constexpr float kRelaxations[] = {1.2f, 1.5f, 1.8f};
+// The flythrough suite moves the camera this fraction of the way towards the
+// origin per frame, over this many frames.
+constexpr float kFlythroughStep = 0.01f;
+constexpr uint32_t kFlythroughFrames = 16;
+// The pan suite moves 2D views this many pixels right and down per frame,
+// over this many frames.
+constexpr uint32_t kPanPixels = 8;
+constexpr uint32_t kPanFrames = 16;
+// The zoom suite zooms 2D views in by kZoomSteps steps of 2^(1/4) and out
+// again.
+constexpr uint32_t kZoomSteps = 8;
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " [options]\n"
+      << "Benchmarks the CPU kernels and renderer on fixed scene presets.\n\n"
+         "  --suites LIST       comma-separated: kernels, frames, scaling,\n"
+         "                      flythrough, pan, zoom\n"
+         "  --fractal NAME      only run presets of this fractal\n"
+         "  --repeat N          timed runs per case (default 5)\n"
+         "  --resolutions LIST  frame sizes, e.g. 640x480,1920x1080\n"
+         "  --scaling-size WxH  frame size of the scaling, flythrough, pan "
+         "and zoom\n"
+         "                      suites\n"
+         "  --max-threads N     largest thread count for scaling\n"
+         "  --format FMT        json or csv (default json)\n"
+         "  --output PATH       write results to PATH instead of stdout\n";
+}
+
+std::vector<std::string> Split(const std::string& value) {
+  std::vector<std::string> items;
+  size_t start = 0;
+  while (start <= value.size()) {
+    const size_t end = std::min(value.find(',', start), value.size());
+    items.push_back(value.substr(start, end - start));
+    start = end + 1;
+  }
+  return items;
+}
+
+Resolution ParseResolution(const std::string& value) {
+  const size_t x = value.find('x');
+  if (x == std::string::npos) {
+    throw std::invalid_argument("resolution '" + value + "' is not WxH");
+  }
+  return {static_cast<uint32_t>(std::stoul(value.substr(0, x))),
+          static_cast<uint32_t>(std::stoul(value.substr(x + 1)))};
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+  Options options;
+
+  for (int i = 1; i < argc; i += 2) {
+    const std::string key = argv[i];
+    if (i + 1 >= argc) {
+      throw std::invalid_argument(key + " expects a value");
+    }
+    const std::string value = argv[i + 1];
+
+    if (key == "--suites") {
+      options.suites = Split(value);
+    } else if (key == "--fractal") {
+      options.fractal = value;
+    } else if (key == "--repeat") {
+      options.repeat = std::max(1ul, std::stoul(value));
+    } else if (key == "--resolutions") {
+      options.resolutions.clear();
+      for (const auto& item : Split(value)) {
+        options.resolutions.push_back(ParseResolution(item));
+      }
+    } else if (key == "--scaling-size") {
+      options.scaling_resolution = ParseResolution(value);
+    } else if (key == "--max-threads") {
+      options.max_threads = std::max(1ul, std::stoul(value));
+    } else if (key == "--format") {
+      if (value != "json" && value != "csv") {
+        throw std::invalid_argument("unknown format " + value);
+      }
+      options.format = value;
+    } else if (key == "--output") {
+      options.output = value;
+    } else {
+      throw std::invalid_argument("unknown option " + key);
+    }
+  }
+
+  return options;
+}
+
+bool HasSuite(const Options& options, const std::string& suite) {
+  return std::find(options.suites.begin(), options.suites.end(), suite) !=
+         options.suites.end();
+}
+
+// Runs `fn` once to warm up, then `repeat` timed times. Returns the result
+// with median/min filled in.
+template <typename Fn>
+bench::Result Measure(uint32_t repeat, Fn&& fn) {
+  fn();
+
+  std::vector<double> samples;
+  for (uint32_t i = 0; i < repeat; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+
+  bench::Result result;
+  result.samples = repeat;
+  result.median_ms = samples[samples.size() / 2];
+  result.min_ms = samples.front();
+  return result;
+}
+
+double PerSecond(double count, double ms) { return count / (ms * 1e-3); }
+
+std::vector<render::SimdLevel> SupportedSimdLevels() {
+  std::vector<render::SimdLevel> levels;
+  for (auto level : {render::SimdLevel::kScalar, render::SimdLevel::kAVX2,
+                     render::SimdLevel::kAVX512}) {
+    if (level <= render::DetectSimdLevel()) {
+      levels.push_back(level);
+    }
+  }
+  return levels;
+}
+
+// Deterministic points in [-1.5, 1.5]^3.
+std::vector<Vector3d> MakeSdfPoints() {
+  std::vector<Vector3d> points(kSdfPoints);
+  uint32_t state = 12345;
+  auto next = [&state] {
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) * (3.0f / (1 << 24)) - 1.5f;
+  };
+  for (auto& p : points) {
+    p.x = next();
+    p.y = next();
+    p.z = next();
+  }
+  return points;
+}
+
+void BenchEscapeTime(const Options& options, const bench::ScenePreset& preset,
+                     std::vector<bench::Result>* results) {
+  const auto& settings = preset.settings;
+  const int max_iter = settings.fractal.max_iterations;
+
+  std::vector<float> xs(kKernelSide);
+  std::vector<float> ys(kKernelSide);
+  for (uint32_t i = 0; i < kKernelSide; ++i) {
+    const auto pos =
+        render::PixelToPosition(i, i, kKernelSide, kKernelSide,
+                                settings.camera);
+    xs[i] = pos.x;
+    ys[i] = pos.y;
+  }
+  std::vector<int> out(kKernelSide);
+  std::vector<float> row_ys(kKernelSide);
+
+  for (auto level : SupportedSimdLevels()) {
+    const auto& kernels = render::GetEscapeTimeKernels(level);
+    auto result = Measure(options.repeat, [&] {
+      for (uint32_t row = 0; row < kKernelSide; ++row) {
+        std::fill(row_ys.begin(), row_ys.end(), ys[row]);
+        if (settings.fractal.type == render::FractalType::kMandelbrot) {
+          kernels.mandelbrot(xs.data(), row_ys.data(), kKernelSide, max_iter,
+                             out.data());
+        } else {
+          kernels.julia(xs.data(), row_ys.data(), kKernelSide, max_iter,
+                        settings.fractal.julia.c_re,
+                        settings.fractal.julia.c_im, out.data());
+        }
+      }
+    });
+    result.benchmark = "escape_time";
+    result.fractal = preset.name;
+    result.variant = render::SimdLevelName(level);
+    result.width = kKernelSide;
+    result.height = kKernelSide;
+    result.threads = 1;
+    result.throughput =
+        PerSecond(kKernelSide * kKernelSide, result.median_ms);
+    result.throughput_unit = "points/s";
+    results->push_back(result);
+  }
+}
+
+// Times the spherical-coordinate Mandelbulb path the whole powers skip, and
+// checks that the trig-free path matches it.
+void BenchMandelbulbTrig(const Options& options,
+                         const bench::ScenePreset& preset,
+                         const std::vector<Vector3d>& points,
+                         std::vector<bench::Result>* results) {
+  const auto& fractal = preset.settings.fractal;
+  const auto& mandelbulb = fractal.mandelbulb;
+
+  // Every whole power has its own trig-free expansion, so each is checked.
+  std::vector<float> errors;
+  errors.reserve(points.size());
+  float worst_p999 = 0.0f;
+  int worst_power = 0;
+  for (int power = 2; power <= render::kMaxMandelbulbIntegerPower; ++power) {
+    errors.clear();
+    for (const auto& p : points) {
+      const float expected = render::MandelbulbSDFAnyPower(
+          p, fractal.max_iterations, power, mandelbulb.boilout);
+      const float actual = render::MandelbulbSDF(p, fractal.max_iterations,
+                                                 power, mandelbulb.boilout);
+      errors.push_back(std::abs(actual - expected) /
+                       std::max(std::abs(expected), 1e-3f));
+    }
+    std::sort(errors.begin(), errors.end());
+    const float p999 = errors[errors.size() * 999 / 1000];
+    if (!(p999 <= kMandelbulbTolerance)) {
+      throw std::runtime_error(
+          "trig-free Mandelbulb distances are off at power " +
+          std::to_string(power));
+    }
+    if (p999 >= worst_p999) {
+      worst_p999 = p999;
+      worst_power = power;
+    }
+  }
+  std::cerr << "  mandelbulb: trig-free distances for powers 2 to "
+            << render::kMaxMandelbulbIntegerPower << " differ by at most "
+            << worst_p999 << " at the 99.9th percentile (relative, power "
+            << worst_power << ")" << std::endl;
+
+  volatile float sink = 0.0f;
+  auto result = Measure(options.repeat, [&] {
+    float sum = 0.0f;
+    for (const auto& p : points) {
+      sum += render::MandelbulbSDFAnyPower(
+          p, fractal.max_iterations, mandelbulb.power, mandelbulb.boilout);
+    }
+    sink = sum;
+  });
+  result.benchmark = "sdf";
+  result.fractal = preset.name;
+  result.variant = "scalar_trig";
+  result.threads = 1;
+  result.throughput = PerSecond(points.size(), result.median_ms);
+  result.throughput_unit = "evals/s";
+  results->push_back(result);
+}
+
+// Times each normal method on the surface points a march found, and
+// reports how far its normals turn from the central-difference ones and
+// whether the dual ones stray no more than the tetrahedral ones.
+void BenchNormals(const Options& options, const bench::ScenePreset& preset,
+                  const std::vector<Vector3d>& surface,
+                  std::vector<bench::Result>* results) {
+  const auto& fractal = preset.settings.fractal;
+  const struct {
+    render::NormalMethod method;
+    const char* name;
+  } kMethods[] = {
+      {render::NormalMethod::kCentral, "central"},
+      {render::NormalMethod::kTetrahedral, "tetrahedral"},
+      {render::NormalMethod::kDual, "dual"},
+  };
+
+  // How far a method's normals stray from central ones.
+  struct Deviation {
+    double p999_degrees = 0.0;
+    // Normals more than 90 degrees off.
+    size_t opposite = 0;
+  };
+  Deviation tetrahedral;
+
+  std::vector<Vector3d> reference(surface.size());
+  std::vector<Vector3d> normals(surface.size());
+  for (const auto& [method, name] : kMethods) {
+    auto result = render::DispatchFractal3D(fractal.type, [&](auto type) {
+      return Measure(options.repeat, [&] {
+        for (size_t i = 0; i < surface.size(); ++i) {
+          normals[i] = render::GetNormal<decltype(type)::value>(
+              surface[i], fractal, method);
+        }
+      });
+    });
+    result.benchmark = "normal";
+    result.fractal = preset.name;
+    result.variant = name;
+    result.threads = 1;
+    result.throughput = PerSecond(surface.size(), result.median_ms);
+    result.throughput_unit = "normals/s";
+    results->push_back(result);
+
+    if (method == render::NormalMethod::kCentral) {
+      reference = normals;
+      continue;
+    }
+    std::vector<double> degrees(surface.size());
+    double sum_degrees = 0.0;
+    for (size_t i = 0; i < surface.size(); ++i) {
+      const float cosine =
+          std::clamp(Dot(normals[i], reference[i]), -1.0f, 1.0f);
+      // NaN normals count as opposite.
+      degrees[i] =
+          std::isnan(cosine) ? 180.0 : std::acos(cosine) * kDegreesPerRadian;
+      sum_degrees += degrees[i];
+    }
+    std::sort(degrees.begin(), degrees.end());
+    Deviation deviation;
+    deviation.p999_degrees = degrees[degrees.size() * 999 / 1000];
+    deviation.opposite =
+        degrees.end() - std::upper_bound(degrees.begin(), degrees.end(), 90.0);
+    std::cerr << "  " << name << " normals: " << sum_degrees / surface.size()
+              << " degrees from central on average, "
+              << deviation.p999_degrees << " at the 99.9th percentile, "
+              << degrees.back() << " at most, " << deviation.opposite
+              << " facing away" << std::endl;
+
+    // Tetrahedral normals are the accepted approximation; dual ones are
+    // usable when their outliers are no worse.
+    if (method == render::NormalMethod::kTetrahedral) {
+      tetrahedral = deviation;
+    } else if (method == render::NormalMethod::kDual) {
+      const bool usable =
+          deviation.p999_degrees <= tetrahedral.p999_degrees &&
+          deviation.opposite <= tetrahedral.opposite;
+      std::cerr << "  dual normals are "
+                << (usable ? "usable: outliers no worse than tetrahedral"
+                           : "NOT usable: outliers worse than tetrahedral")
+                << std::endl;
+    }
+  }
+}
+
+// Times over-relaxed marches of `rays` with the widest marcher, and reports
+// their steps per ray and how many rays end elsewhere than `plain` ones.
+void BenchRelaxation(const Options& options, const bench::ScenePreset& preset,
+                     const std::vector<Ray>& rays,
+                     const std::vector<render::MarchResult>& plain,
+                     std::vector<bench::Result>* results) {
+  const auto march = render::GetPacketMarcher(render::DetectSimdLevel());
+  auto count_steps = [](const std::vector<render::MarchResult>& hits) {
+    double steps = 0.0;
+    for (const auto& hit : hits) {
+      steps += hit.steps;
+    }
+    return steps / hits.size();
+  };
+  const double plain_steps = count_steps(plain);
+  std::cerr << "  plain march: " << plain_steps << " steps per ray"
+            << std::endl;
+
+  std::vector<render::MarchResult> hits(rays.size());
+  for (const float relaxation : kRelaxations) {
+    render::MarchLimits limits;
+    limits.relaxation = relaxation;
+    auto result = Measure(options.repeat, [&] {
+      march(rays.data(), nullptr, rays.size(), preset.settings, limits,
+            hits.data());
+    });
+    std::ostringstream variant;
+    variant << "relaxed_" << relaxation;
+    result.benchmark = "march";
+    result.fractal = preset.name;
+    result.variant = variant.str();
+    result.width = kKernelSide;
+    result.height = kKernelSide;
+    result.threads = 1;
+    result.throughput = PerSecond(rays.size(), result.median_ms);
+    result.throughput_unit = "rays/s";
+    results->push_back(result);
+
+    // Rays that end with another status, e.g. hit where plain steps ran
+    // out, and rays that both hit but more than one hit distance apart.
+    uint32_t changed = 0;
+    uint32_t moved = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+      if (hits[i].status != plain[i].status) {
+        ++changed;
+      } else if (plain[i].status == render::MarchStatus::kHit &&
+                 std::abs(hits[i].t - plain[i].t) >
+                     render::MarchLimits{}.hit_epsilon * plain[i].t) {
+        ++moved;
+      }
+    }
+    // Relaxation only pays off if it takes fewer steps than plain tracing.
+    const double steps = count_steps(hits);
+    std::cerr << "  relaxation " << relaxation << ": " << steps
+              << " steps per ray, "
+              << (steps < plain_steps ? "fewer" : "MORE") << " than plain; of "
+              << rays.size() << " rays " << changed << " end otherwise and "
+              << moved << " hit elsewhere" << std::endl;
+  }
+}
+
+void BenchSdf(const Options& options, const bench::ScenePreset& preset,
+              std::vector<bench::Result>* results) {
+  const auto& settings = preset.settings;
+
+  static const auto kPoints = MakeSdfPoints();
+  volatile float sink = 0.0f;
+  auto sdf = Measure(options.repeat, [&] {
+    float sum = 0.0f;
+    for (const auto& p : kPoints) {
+      sum += render::CalculateSignedDistance(p, settings);
+    }
+    sink = sum;
+  });
+  sdf.benchmark = "sdf";
+  sdf.fractal = preset.name;
+  sdf.variant = "scalar";
+  sdf.threads = 1;
+  sdf.throughput = PerSecond(kPoints.size(), sdf.median_ms);
+  sdf.throughput_unit = "evals/s";
+  results->push_back(sdf);
+
+  // The same loop with the type switch hoisted out of it.
+  auto specialized = render::DispatchFractal3D(
+      settings.fractal.type, [&](auto type) {
+        return Measure(options.repeat, [&] {
+          float sum = 0.0f;
+          for (const auto& p : kPoints) {
+            sum += render::SignedDistance<decltype(type)::value>(
+                p, settings.fractal);
+          }
+          sink = sum;
+        });
+      });
+  specialized.benchmark = "sdf";
+  specialized.fractal = preset.name;
+  specialized.variant = "scalar_specialized";
+  specialized.threads = 1;
+  specialized.throughput = PerSecond(kPoints.size(), specialized.median_ms);
+  specialized.throughput_unit = "evals/s";
+  results->push_back(specialized);
+
+  if (settings.fractal.type == render::FractalType::kMandelbulb) {
+    BenchMandelbulbTrig(options, preset, kPoints, results);
+  }
+
+  std::vector<Ray> rays;
+  for (uint32_t y = 0; y < kKernelSide; ++y) {
+    for (uint32_t x = 0; x < kKernelSide; ++x) {
+      rays.push_back(
+          render::MakeRay(x, y, kKernelSide, kKernelSide, settings.camera));
+    }
+  }
+  std::vector<render::MarchResult> hits(rays.size());
+
+  for (auto level : SupportedSimdLevels()) {
+    const auto march = render::GetPacketMarcher(level);
+    auto result = Measure(options.repeat, [&] {
+      march(rays.data(), nullptr, rays.size(), settings, render::MarchLimits{},
+            hits.data());
+    });
+    result.benchmark = "march";
+    result.fractal = preset.name;
+    result.variant = render::SimdLevelName(level);
+    result.width = kKernelSide;
+    result.height = kKernelSide;
+    result.threads = 1;
+    result.throughput = PerSecond(rays.size(), result.median_ms);
+    result.throughput_unit = "rays/s";
+    results->push_back(result);
+  }
+
+  BenchRelaxation(options, preset, rays, hits, results);
+
+  std::vector<Vector3d> surface;
+  for (size_t i = 0; i < rays.size(); ++i) {
+    if (hits[i].status == render::MarchStatus::kHit) {
+      surface.push_back(rays[i].position + rays[i].direction * hits[i].t);
+    }
+  }
+  if (!surface.empty()) {
+    BenchNormals(options, preset, surface, results);
+  }
+}
+
+bench::Result BenchFrame(const Options& options,
+                         const bench::ScenePreset& preset, Resolution size,
+                         render::CPURendererOptions renderer_options) {
+  // Every timed frame repeats the same view; measure it from scratch.
+  renderer_options.reuse_depth = false;
+  renderer_options.incremental_pan = false;
+  renderer_options.tile_cache_bytes = 0;
+  render::CPURenderer renderer(renderer_options);
+  renderer.Resize(size.width, size.height);
+
+  auto settings = preset.settings;
+  settings.camera.aspect = static_cast<float>(size.width) / size.height;
+
+  auto result =
+      Measure(options.repeat, [&] { renderer.RenderFrame(settings); });
+  result.fractal = preset.name;
+  result.width = size.width;
+  result.height = size.height;
+  result.threads = renderer_options.threads;
+  result.throughput =
+      PerSecond(static_cast<double>(size.width) * size.height,
+                result.median_ms);
+  result.throughput_unit =
+      render::Is2DFractal(settings.fractal.type) ? "pixels/s" : "rays/s";
+  return result;
+}
+
+void BenchFrames(const Options& options, const bench::ScenePreset& preset,
+                 std::vector<bench::Result>* results) {
+  render::CPURendererOptions renderer_options;
+  renderer_options.threads = options.max_threads;
+
+  for (const auto& size : options.resolutions) {
+    if (!render::Is2DFractal(preset.settings.fractal.type)) {
+      auto result = BenchFrame(options, preset, size, renderer_options);
+      result.benchmark = "frame";
+      results->push_back(result);
+
+      // The same frame with the opt-in cone pre-pass.
+      auto coned = renderer_options;
+      coned.cone_prepass = true;
+      result = BenchFrame(options, preset, size, coned);
+      result.benchmark = "frame";
+      result.variant = "cone";
+      results->push_back(result);
+    } else {
+      // 2D frames with and without Mariani-Silver subdivision.
+      for (auto subdivision :
+           {render::Subdivision2D::kOff, render::Subdivision2D::kOn}) {
+        renderer_options.subdivision = subdivision;
+        auto result = BenchFrame(options, preset, size, renderer_options);
+        result.benchmark = "frame";
+        result.variant =
+            subdivision == render::Subdivision2D::kOn ? "subdivide" : "full";
+        results->push_back(result);
+      }
+    }
+
+    // The default frame with edge pixels supersampled.
+    auto antialiased = renderer_options;
+    antialiased.antialias = kAntialiasSamples;
+    auto result = BenchFrame(options, preset, size, antialiased);
+    result.benchmark = "frame";
+    result.variant = "antialias";
+    results->push_back(result);
+  }
+}
+
+void BenchScaling(const Options& options, const bench::ScenePreset& preset,
+                  std::vector<bench::Result>* results) {
+  std::vector<uint32_t> thread_counts;
+  for (uint32_t threads = 1; threads < options.max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(options.max_threads);
+
+  double single_thread_ms = 0.0;
+  for (uint32_t threads : thread_counts) {
+    render::CPURendererOptions renderer_options;
+    renderer_options.threads = threads;
+    auto result = BenchFrame(options, preset, options.scaling_resolution,
+                             renderer_options);
+    if (threads == 1) {
+      single_thread_ms = result.median_ms;
+    }
+    result.benchmark = "scaling";
+    result.throughput = single_thread_ms / result.median_ms;
+    result.throughput_unit = "speedup";
+    results->push_back(result);
+  }
+}
+
+// Renders a short camera move with and without reprojected depth reuse.
+void BenchFlythrough(const Options& options, const bench::ScenePreset& preset,
+                     std::vector<bench::Result>* results) {
+  const Resolution size = options.scaling_resolution;
+
+  for (bool reuse : {false, true}) {
+    render::CPURendererOptions renderer_options;
+    renderer_options.threads = options.max_threads;
+    renderer_options.reuse_depth = reuse;
+    render::CPURenderer renderer(renderer_options);
+    renderer.Resize(size.width, size.height);
+
+    auto settings = preset.settings;
+    settings.camera.aspect = static_cast<float>(size.width) / size.height;
+    const Vector3d start = settings.camera.position;
+
+    auto result = Measure(options.repeat, [&] {
+      for (uint32_t frame = 0; frame < kFlythroughFrames; ++frame) {
+        settings.camera.position = start * (1.0f - kFlythroughStep * frame);
+        renderer.RenderFrame(settings);
+      }
+    });
+    result.benchmark = "flythrough";
+    result.fractal = preset.name;
+    result.variant = reuse ? "depth-reuse" : "cold";
+    result.width = size.width;
+    result.height = size.height;
+    result.threads = options.max_threads;
+    result.throughput = PerSecond(kFlythroughFrames, result.median_ms);
+    result.throughput_unit = "frames/s";
+    results->push_back(result);
+  }
+}
+
+void BenchPan(const Options& options, const bench::ScenePreset& preset,
+              std::vector<bench::Result>* results) {
+  const Resolution size = options.scaling_resolution;
+
+  for (bool incremental : {false, true}) {
+    render::CPURendererOptions renderer_options;
+    renderer_options.threads = options.max_threads;
+    renderer_options.incremental_pan = incremental;
+    renderer_options.tile_cache_bytes = 0;
+    render::CPURenderer renderer(renderer_options);
+    renderer.Resize(size.width, size.height);
+
+    auto settings = preset.settings;
+    settings.camera.aspect = static_cast<float>(size.width) / size.height;
+    const auto start = settings.view2d;
+    const double pixel_x =
+        2.0 * settings.camera.aspect * start.scale / size.width;
+    const double pixel_y = 2.0 * start.scale / size.height;
+
+    auto result = Measure(options.repeat, [&] {
+      for (uint32_t frame = 0; frame < kPanFrames; ++frame) {
+        const double pixels = static_cast<double>(frame) * kPanPixels;
+        settings.view2d.center_x =
+            start.center_x + render::FixedPoint::FromDouble(pixels * pixel_x);
+        settings.view2d.center_y =
+            start.center_y + render::FixedPoint::FromDouble(pixels * pixel_y);
+        renderer.RenderFrame(settings);
+      }
+    });
+    result.benchmark = "pan";
+    result.fractal = preset.name;
+    result.variant = incremental ? "incremental" : "full";
+    result.width = size.width;
+    result.height = size.height;
+    result.threads = options.max_threads;
+    result.throughput = PerSecond(kPanFrames, result.median_ms);
+    result.throughput_unit = "frames/s";
+    results->push_back(result);
+  }
+}
+
+void BenchZoom(const Options& options, const bench::ScenePreset& preset,
+               std::vector<bench::Result>* results) {
+  const Resolution size = options.scaling_resolution;
+  const uint32_t frames = 2 * kZoomSteps + 1;
+
+  for (bool cached : {false, true}) {
+    render::CPURendererOptions renderer_options;
+    renderer_options.threads = options.max_threads;
+    if (!cached) {
+      renderer_options.tile_cache_bytes = 0;
+    }
+    render::CPURenderer renderer(renderer_options);
+    renderer.Resize(size.width, size.height);
+
+    auto settings = preset.settings;
+    settings.camera.aspect = static_cast<float>(size.width) / size.height;
+    const double scale = settings.view2d.scale;
+
+    auto result = Measure(options.repeat, [&] {
+      // Every run starts cold; only the way back out can hit the cache.
+      renderer.ClearTileCache();
+      for (uint32_t frame = 0; frame < frames; ++frame) {
+        const uint32_t step =
+            frame <= kZoomSteps ? frame : 2 * kZoomSteps - frame;
+        settings.view2d.scale = scale * std::exp2(-0.25 * step);
+        renderer.RenderFrame(settings);
+      }
+    });
+    result.benchmark = "zoom";
+    result.fractal = preset.name;
+    result.variant = cached ? "cached" : "uncached";
+    result.width = size.width;
+    result.height = size.height;
+    result.threads = options.max_threads;
+    result.throughput = PerSecond(frames, result.median_ms);
+    result.throughput_unit = "frames/s";
+    results->push_back(result);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--help") == 0 ||
+        std::strcmp(argv[i], "-h") == 0) {
+      PrintUsage(argv[0]);
+      return 0;
+    }
+  }
+
+  try {
+    const auto options = ParseOptions(argc, argv);
+
+    std::vector<bench::Result> results;
+    for (const auto& preset : bench::GetPresets()) {
+      if (!options.fractal.empty() && options.fractal != preset.name) {
+        continue;
+      }
+      std::cerr << "benchmarking " << preset.name << std::endl;
+
+      if (HasSuite(options, "kernels")) {
+        if (render::Is2DFractal(preset.settings.fractal.type)) {
+          BenchEscapeTime(options, preset, &results);
+        } else {
+          BenchSdf(options, preset, &results);
+        }
+      }
+      if (HasSuite(options, "frames")) {
+        BenchFrames(options, preset, &results);
+      }
+      if (HasSuite(options, "scaling")) {
+        BenchScaling(options, preset, &results);
+      }
+      if (HasSuite(options, "flythrough") &&
+          !render::Is2DFractal(preset.settings.fractal.type)) {
+        BenchFlythrough(options, preset, &results);
+      }
+      if (HasSuite(options, "pan") &&
+          render::Is2DFractal(preset.settings.fractal.type)) {
+        BenchPan(options, preset, &results);
+      }
+      if (HasSuite(options, "zoom") &&
+          render::Is2DFractal(preset.settings.fractal.type)) {
+        BenchZoom(options, preset, &results);
+      }
+    }
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+      file.open(options.output);
+      if (!file) {
+        throw std::runtime_error("cannot open " + options.output);
+      }
+    }
+    std::ostream& out = options.output.empty() ? std::cout : file;
+
+    if (options.format == "csv") {
+      bench::WriteCSV(out, results);
+    } else {
+      bench::RunInfo info;
+      info.simd = render::SimdLevelName(render::DetectSimdLevel());
+      info.hardware_threads = std::thread::hardware_concurrency();
+      bench::WriteJSON(out, info, results);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
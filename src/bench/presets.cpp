@@ -0,0 +1,39 @@
+#include "bench/presets.h"
+
+#include "cli/scene_options.h"
+
+namespace bench {
+
+namespace {
+
+ScenePreset MakePreset(render::FractalType type, uint32_t iterations,
+                       Vector3d position, float scale = 1.0f) {
+  ScenePreset preset;
+  preset.name = cli::FractalTypeName(type);
+  preset.settings.fractal.type = type;
+  preset.settings.fractal.max_iterations = iterations;
+  preset.settings.camera.position = position;
+  preset.settings.camera.scale = scale;
+  preset.settings.view2d.center_x = render::FixedPoint::FromDouble(position.x);
+  preset.settings.view2d.center_y = render::FixedPoint::FromDouble(position.y);
+  preset.settings.view2d.scale = scale;
+  return preset;
+}
+
+}  // namespace
+
+const std::vector<ScenePreset>& GetPresets() {
+  using render::FractalType;
+
+  static const std::vector<ScenePreset> kPresets = {
+      MakePreset(FractalType::kMandelbrot, 256, {-0.5f, 0.0f, 0.0f}, 1.2f),
+      MakePreset(FractalType::kJulia, 256, {0.0f, 0.0f, 0.0f}, 1.5f),
+      MakePreset(FractalType::kMengerSponge, 5, {0.0f, -2.5f, 0.0f}),
+      MakePreset(FractalType::kMandelbulb, 8, {0.0f, -2.2f, 0.0f}),
+      MakePreset(FractalType::kMandelbox, 10, {0.0f, -4.0f, 0.0f}),
+      MakePreset(FractalType::kJuliabulb, 8, {0.0f, -2.0f, 0.0f}),
+  };
+  return kPresets;
+}
+
+}  // namespace bench
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "render/settings_provider.h"
+
+namespace bench {
+
+// Fixed scene used to benchmark one fractal type. Presets never change
+// between builds, so their timings are comparable over time.
+struct ScenePreset {
+  std::string name;
+  render::RenderSettings settings;
+};
+
+// One preset per render::FractalType, in enum order.
+const std::vector<ScenePreset>& GetPresets();
+
+}  // namespace bench
@@ -0,0 +1,45 @@
+#include "bench/report.h"
+
+namespace bench {
+
+namespace {
+
+// Benchmark and fractal names are plain identifiers, so no escaping needed.
+std::string Quote(const std::string& value) { return "\"" + value + "\""; }
+
+}  // namespace
+
+void WriteCSV(std::ostream& out, const std::vector<Result>& results) {
+  out << "benchmark,fractal,variant,width,height,threads,samples,median_ms,"
+         "min_ms,throughput,throughput_unit\n";
+  for (const auto& r : results) {
+    out << r.benchmark << "," << r.fractal << "," << r.variant << ","
+        << r.width << "," << r.height << "," << r.threads << "," << r.samples
+        << "," << r.median_ms << "," << r.min_ms << "," << r.throughput << ","
+        << r.throughput_unit << "\n";
+  }
+}
+
+void WriteJSON(std::ostream& out, const RunInfo& info,
+               const std::vector<Result>& results) {
+  out << "{\n";
+  out << "  \"simd\": " << Quote(info.simd) << ",\n";
+  out << "  \"hardware_threads\": " << info.hardware_threads << ",\n";
+  out << "  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    out << "    {\"benchmark\": " << Quote(r.benchmark)
+        << ", \"fractal\": " << Quote(r.fractal)
+        << ", \"variant\": " << Quote(r.variant) << ", \"width\": " << r.width
+        << ", \"height\": " << r.height << ", \"threads\": " << r.threads
+        << ", \"samples\": " << r.samples
+        << ", \"median_ms\": " << r.median_ms << ", \"min_ms\": " << r.min_ms
+        << ", \"throughput\": " << r.throughput
+        << ", \"throughput_unit\": " << Quote(r.throughput_unit) << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n";
+  out << "}\n";
+}
+
+}  // namespace bench
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// One measured benchmark case.
+struct Result {
+  std::string benchmark;
+  std::string fractal;
+  // SIMD level for kernel benchmarks, empty otherwise.
+  std::string variant;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t threads = 0;
+  uint32_t samples = 0;
+  double median_ms = 0.0;
+  double min_ms = 0.0;
+  double throughput = 0.0;
+  std::string throughput_unit;
+};
+
+// Describes the machine and build the results were measured on.
+struct RunInfo {
+  std::string simd;
+  uint32_t hardware_threads = 0;
+};
+
+void WriteCSV(std::ostream& out, const std::vector<Result>& results);
+void WriteJSON(std::ostream& out, const RunInfo& info,
+               const std::vector<Result>& results);
+
+}  // namespace bench
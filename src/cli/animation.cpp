@@ -0,0 +1,166 @@
+#include "cli/animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+float Lerp(float a, float b, double u) {
+  return static_cast<float>(a + (b - a) * u);
+}
+
+Vector3d Lerp(const Vector3d& a, const Vector3d& b, double u) {
+  return {Lerp(a.x, b.x, u), Lerp(a.y, b.y, u), Lerp(a.z, b.z, u)};
+}
+
+// Blends in FixedPoint, so deep 2D zooms keep their precision.
+render::FixedPoint Lerp(const render::FixedPoint& a,
+                        const render::FixedPoint& b, double u) {
+  return a + render::FixedPoint::FromDouble((b - a).ToDouble() * u);
+}
+
+// Geometric: a constant zoom factor per unit of `u`.
+double LerpScale(double a, double b, double u) {
+  return a * std::pow(b / a, u);
+}
+
+}  // namespace
+
+namespace cli {
+
+std::vector<Keyframe> ReadKeyframes(const std::string& path,
+                                    const SceneOptions& scene) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path);
+  }
+
+  std::vector<Keyframe> keyframes;
+  SceneOptions current = scene;
+  std::string line;
+  for (int number = 1; std::getline(in, line); ++number) {
+    const auto fail = [&](const std::string& message) {
+      throw std::invalid_argument(path + ":" + std::to_string(number) +
+                                  ": " + message);
+    };
+
+    std::istringstream tokens(line);
+    std::string time;
+    if (!(tokens >> time) || time[0] == '#') {
+      continue;
+    }
+    Keyframe keyframe;
+    try {
+      size_t used = 0;
+      keyframe.time = std::stod(time, &used);
+      if (used != time.size()) {
+        throw std::invalid_argument(time);
+      }
+    } catch (const std::exception&) {
+      fail("'" + time + "' is not a time");
+    }
+
+    std::string key;
+    std::string value;
+    while (tokens >> key) {
+      if (!(tokens >> value)) {
+        fail(key + " expects a value");
+      }
+      if (key == "--width" || key == "--height") {
+        fail("the image size cannot change");
+      }
+      bool applied = false;
+      try {
+        applied = ApplySceneOption(key, value, &current);
+      } catch (const std::invalid_argument& e) {
+        fail(e.what());
+      }
+      if (!applied) {
+        fail("unknown scene option " + key);
+      }
+    }
+    // --fractal resets the camera aspect too.
+    FinalizeScene(&current);
+    keyframe.settings = current.settings;
+
+    if (!keyframes.empty()) {
+      if (keyframe.time <= keyframes.back().time) {
+        fail("times must increase");
+      }
+      if (keyframe.settings.fractal.type !=
+          keyframes.back().settings.fractal.type) {
+        fail("keyframes must share the fractal type");
+      }
+    }
+    keyframes.push_back(keyframe);
+  }
+
+  if (keyframes.empty()) {
+    throw std::invalid_argument(path + ": no keyframes");
+  }
+  return keyframes;
+}
+
+render::RenderSettings InterpolateKeyframes(
+    const std::vector<Keyframe>& keyframes, double time) {
+  if (time <= keyframes.front().time) {
+    return keyframes.front().settings;
+  }
+  if (time >= keyframes.back().time) {
+    return keyframes.back().settings;
+  }
+
+  const auto next = std::upper_bound(
+      keyframes.begin(), keyframes.end(), time,
+      [](double t, const Keyframe& keyframe) { return t < keyframe.time; });
+  const auto& a = (next - 1)->settings;
+  const auto& b = next->settings;
+  const double u = (time - (next - 1)->time) / (next->time - (next - 1)->time);
+
+  render::RenderSettings settings = a;
+
+  auto& camera = settings.camera;
+  camera.position = Lerp(a.camera.position, b.camera.position, u);
+  camera.direction =
+      Normalize(Lerp(a.camera.direction, b.camera.direction, u));
+  camera.scale = LerpScale(a.camera.scale, b.camera.scale, u);
+
+  // The center moves in step with the zoom, so a point kept still by the
+  // keyframes stays still on screen: what is left of its way to b shrinks as
+  // the scale approaches b's.
+  auto& view2d = settings.view2d;
+  view2d.scale = LerpScale(a.view2d.scale, b.view2d.scale, u);
+  const double center_u =
+      a.view2d.scale == b.view2d.scale
+          ? u
+          : (view2d.scale - a.view2d.scale) / (b.view2d.scale - a.view2d.scale);
+  view2d.center_x = Lerp(a.view2d.center_x, b.view2d.center_x, center_u);
+  view2d.center_y = Lerp(a.view2d.center_y, b.view2d.center_y, center_u);
+
+  auto& fractal = settings.fractal;
+  fractal.max_iterations = static_cast<uint32_t>(std::lround(
+      a.fractal.max_iterations +
+      (static_cast<double>(b.fractal.max_iterations) -
+       a.fractal.max_iterations) * u));
+  fractal.julia.c_re = Lerp(a.fractal.julia.c_re, b.fractal.julia.c_re, u);
+  fractal.julia.c_im = Lerp(a.fractal.julia.c_im, b.fractal.julia.c_im, u);
+  fractal.mandelbulb.power =
+      Lerp(a.fractal.mandelbulb.power, b.fractal.mandelbulb.power, u);
+  fractal.mandelbulb.boilout =
+      Lerp(a.fractal.mandelbulb.boilout, b.fractal.mandelbulb.boilout, u);
+  fractal.mandelbox.min_radius =
+      Lerp(a.fractal.mandelbox.min_radius, b.fractal.mandelbox.min_radius, u);
+  fractal.mandelbox.fixed_radius = Lerp(a.fractal.mandelbox.fixed_radius,
+                                        b.fractal.mandelbox.fixed_radius, u);
+  fractal.mandelbox.scale =
+      Lerp(a.fractal.mandelbox.scale, b.fractal.mandelbox.scale, u);
+  fractal.juliabulb.c = Lerp(a.fractal.juliabulb.c, b.fractal.juliabulb.c, u);
+  fractal.juliabulb.power =
+      Lerp(a.fractal.juliabulb.power, b.fractal.juliabulb.power, u);
+  return settings;
+}
+
+}  // namespace cli
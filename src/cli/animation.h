@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "cli/scene_options.h"
+#include "render/settings_provider.h"
+
+namespace cli {
+
+// Settings a keyframed animation passes through at `time` seconds.
+struct Keyframe {
+  double time;
+  render::RenderSettings settings;
+};
+
+// Reads a keyframe file. Each line holds a time in seconds followed by
+// scene options as the command line takes them, e.g.
+//
+//   0    --position 0,-2.5,0 --direction 0,1,0
+//   2.5  --position 0,-1.4,0.2 --mandelbulb-power 9
+//
+// Each keyframe starts from the one before it, the first from `scene`, so
+// lines only list what changes. Times must increase, keyframes must share
+// the fractal type and the image size stays that of `scene`. Blank lines
+// and lines starting with # are skipped. Throws std::invalid_argument with
+// the line number on malformed lines.
+std::vector<Keyframe> ReadKeyframes(const std::string& path,
+                                    const SceneOptions& scene);
+
+// The settings at `time`, interpolated between the keyframes around it:
+// linearly, except for scales, which change by a constant factor per second
+// so zooms run at a steady pace. Iteration limits are rounded; options that
+// cannot blend, such as the heatmap, switch on reaching a keyframe. Times
+// outside the keyframes hold the first or last one.
+render::RenderSettings InterpolateKeyframes(
+    const std::vector<Keyframe>& keyframes, double time);
+
+}  // namespace cli
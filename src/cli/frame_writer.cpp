@@ -0,0 +1,105 @@
+#include "cli/frame_writer.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "cli/image_writer.h"
+#include "render/cpu/trace.h"
+
+namespace cli {
+
+namespace {
+
+// "dir/frame.png" is written as "dir/frame.partial.png", which keeps the
+// extension WriteImage picks the format from.
+std::filesystem::path PartialPath(const std::string& path) {
+  std::filesystem::path partial(path);
+  partial.replace_extension(".partial" + partial.extension().string());
+  return partial;
+}
+
+}  // namespace
+
+FrameWriter::FrameWriter(size_t max_pending)
+    : max_pending_(std::max<size_t>(max_pending, 1)),
+      thread_(&FrameWriter::Run, this) {}
+
+FrameWriter::~FrameWriter() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  thread_.join();
+}
+
+void FrameWriter::Write(const std::string& path, const Color* pixels,
+                        uint32_t width, uint32_t height) {
+  std::vector<Color> copy;
+  {
+    std::unique_lock lock(mutex_);
+    changed_.wait(lock,
+                  [this] { return jobs_.size() < max_pending_ || error_; });
+    ThrowError();
+    if (!spare_.empty()) {
+      copy = std::move(spare_.back());
+      spare_.pop_back();
+    }
+  }
+
+  // Copied unlocked: only this thread adds jobs, so the queue cannot fill
+  // up meanwhile.
+  copy.assign(pixels, pixels + static_cast<size_t>(width) * height);
+  {
+    std::lock_guard lock(mutex_);
+    jobs_.push_back({path, std::move(copy), width, height});
+  }
+  changed_.notify_all();
+}
+
+void FrameWriter::Finish() {
+  std::unique_lock lock(mutex_);
+  changed_.wait(lock, [this] { return jobs_.empty(); });
+  ThrowError();
+}
+
+void FrameWriter::Run() {
+  render::Tracer::Get().SetThreadName("writer");
+  std::unique_lock lock(mutex_);
+  while (true) {
+    changed_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+    if (jobs_.empty()) {
+      return;
+    }
+
+    // The job stays queued while it is written, so it counts as pending.
+    // Adding jobs to a deque keeps references to the others valid.
+    Job& job = jobs_.front();
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+      render::TraceSpan span("write_image");
+      const auto partial = PartialPath(job.path);
+      WriteImage(partial.string(), job.pixels.data(), job.width, job.height);
+      std::filesystem::rename(partial, job.path);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+
+    if (error && !error_) {
+      error_ = error;
+    }
+    spare_.push_back(std::move(job.pixels));
+    jobs_.pop_front();
+    changed_.notify_all();
+  }
+}
+
+void FrameWriter::ThrowError() {
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+}  // namespace cli
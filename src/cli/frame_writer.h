@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "render/common/types.h"
+
+namespace cli {
+
+// Writes images with WriteImage on a thread of its own, so encoding and
+// writing one frame of a sequence overlaps with rendering the next. Each
+// image goes to a temporary file that is renamed into place once complete:
+// a path that exists holds a whole image, even after the process was killed
+// mid-write. Write and Finish are called from one thread.
+class FrameWriter {
+ public:
+  // Write blocks while `max_pending` images wait to be written.
+  explicit FrameWriter(size_t max_pending = 2);
+  // Waits for the queued images. Their errors are lost; call Finish first.
+  ~FrameWriter();
+
+  FrameWriter(const FrameWriter&) = delete;
+  FrameWriter& operator=(const FrameWriter&) = delete;
+
+  // Queues a copy of `pixels` to be written to `path`. Throws the error of
+  // an earlier image that failed to write.
+  void Write(const std::string& path, const Color* pixels, uint32_t width,
+             uint32_t height);
+  // Blocks until every queued image is written. Throws the first write
+  // error.
+  void Finish();
+
+ private:
+  struct Job {
+    std::string path;
+    std::vector<Color> pixels;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  void Run();
+  // Throws error_, if set. Needs mutex_.
+  void ThrowError();
+
+  const size_t max_pending_;
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  // Queued jobs, the front one being written.
+  std::deque<Job> jobs_;
+  bool stop_ = false;
+  std::exception_ptr error_;
+  // Pixel buffers of written jobs, reused for the next ones.
+  std::vector<std::vector<Color>> spare_;
+
+  std::thread thread_;
+};
+
+}  // namespace cli
@@ -0,0 +1,176 @@
+#include "cli/image_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+std::ofstream OpenOutput(const std::string& path) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    throw std::runtime_error("cannot open " + path + " for writing");
+  }
+  return out;
+}
+
+void CheckWritten(const std::ofstream& out, const std::string& path) {
+  if (!out) {
+    throw std::runtime_error("failed to write " + path);
+  }
+}
+
+bool EndsWith(const std::string& value, const std::string& suffix) {
+  return value.size() >= suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(), suffix) ==
+             0;
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+  static const auto kTable = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+    return table;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = kTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back(value >> 24);
+  out.push_back(value >> 16);
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+void AppendChunk(std::vector<uint8_t>& png, const char* type,
+                 const std::vector<uint8_t>& data) {
+  AppendBigEndian(png, static_cast<uint32_t>(data.size()));
+
+  const size_t type_offset = png.size();
+  png.insert(png.end(), type, type + 4);
+  png.insert(png.end(), data.begin(), data.end());
+
+  AppendBigEndian(png, Crc32(png.data() + type_offset, data.size() + 4));
+}
+
+// zlib stream of the raw scanlines. Without zlib the data goes into stored
+// (uncompressed) deflate blocks, which every PNG reader accepts.
+std::vector<uint8_t> Deflate(const std::vector<uint8_t>& raw) {
+#ifdef HAVE_ZLIB
+  uLongf size = compressBound(raw.size());
+  std::vector<uint8_t> out(size);
+  if (compress2(out.data(), &size, raw.data(), raw.size(), 6) != Z_OK) {
+    throw std::runtime_error("zlib compression failed");
+  }
+  out.resize(size);
+  return out;
+#else
+  constexpr size_t kMaxBlock = 65535;
+
+  std::vector<uint8_t> out = {0x78, 0x01};
+  size_t offset = 0;
+  do {
+    const size_t block = std::min(kMaxBlock, raw.size() - offset);
+    const bool last = offset + block == raw.size();
+
+    out.push_back(last ? 1 : 0);
+    out.push_back(block & 0xff);
+    out.push_back(block >> 8);
+    out.push_back(~block & 0xff);
+    out.push_back((~block >> 8) & 0xff);
+    out.insert(out.end(), raw.begin() + offset, raw.begin() + offset + block);
+
+    offset += block;
+  } while (offset < raw.size());
+
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (uint8_t byte : raw) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  AppendBigEndian(out, (b << 16) | a);
+  return out;
+#endif
+}
+
+}  // namespace
+
+namespace cli {
+
+void WritePPM(const std::string& path, const Color* pixels, uint32_t width,
+              uint32_t height) {
+  auto out = OpenOutput(path);
+  out << "P6\n" << width << " " << height << "\n255\n";
+
+  std::vector<uint8_t> row(width * 3);
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      const Color& c = pixels[y * width + x];
+      row[x * 3 + 0] = c.r;
+      row[x * 3 + 1] = c.g;
+      row[x * 3 + 2] = c.b;
+    }
+    out.write(reinterpret_cast<const char*>(row.data()), row.size());
+  }
+
+  CheckWritten(out, path);
+}
+
+void WritePNG(const std::string& path, const Color* pixels, uint32_t width,
+              uint32_t height) {
+  // Every scanline starts with filter type 0 (none).
+  std::vector<uint8_t> raw;
+  raw.reserve((width * sizeof(Color) + 1) * height);
+  for (uint32_t y = 0; y < height; ++y) {
+    raw.push_back(0);
+    const auto* row = reinterpret_cast<const uint8_t*>(pixels + y * width);
+    raw.insert(raw.end(), row, row + width * sizeof(Color));
+  }
+
+  std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+  std::vector<uint8_t> header;
+  AppendBigEndian(header, width);
+  AppendBigEndian(header, height);
+  // 8-bit depth, RGBA, deflate, adaptive filtering, no interlace.
+  header.insert(header.end(), {8, 6, 0, 0, 0});
+
+  AppendChunk(png, "IHDR", header);
+  AppendChunk(png, "IDAT", Deflate(raw));
+  AppendChunk(png, "IEND", {});
+
+  auto out = OpenOutput(path);
+  out.write(reinterpret_cast<const char*>(png.data()), png.size());
+  CheckWritten(out, path);
+}
+
+void WriteImage(const std::string& path, const Color* pixels, uint32_t width,
+                uint32_t height) {
+  if (EndsWith(path, ".png")) {
+    WritePNG(path, pixels, width, height);
+  } else if (EndsWith(path, ".ppm")) {
+    WritePPM(path, pixels, width, height);
+  } else {
+    throw std::invalid_argument("unsupported image format: " + path);
+  }
+}
+
+}  // namespace cli
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "render/common/types.h"
+
+namespace cli {
+
+// Writes `pixels` (width * height RGBA values, top row first) as a binary
+// PPM. The alpha channel is dropped.
+void WritePPM(const std::string& path, const Color* pixels, uint32_t width,
+              uint32_t height);
+
+// Writes `pixels` as an 8-bit RGBA PNG.
+void WritePNG(const std::string& path, const Color* pixels, uint32_t width,
+              uint32_t height);
+
+// Picks the format from the extension of `path` (.png or .ppm).
+void WriteImage(const std::string& path, const Color* pixels, uint32_t width,
+                uint32_t height);
+
+}  // namespace cli
@@ -0,0 +1,300 @@
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "cli/animation.h"
+#include "cli/frame_writer.h"
+#include "cli/image_writer.h"
+#include "cli/renderer_options.h"
+#include "cli/scene_options.h"
+#include "render/cpu/cpu_renderer.h"
+#include "render/cpu/trace.h"
+
+namespace {
+
+struct Options {
+  cli::SceneOptions scene;
+  render::CPURendererOptions renderer;
+  std::string output = "fractal.png";
+  uint32_t frames = 1;
+  // Chrome trace JSON of the run, if not empty.
+  std::string trace;
+  // Keyframe file of an animation to render as an image sequence instead,
+  // if not empty.
+  std::string keyframes;
+  double fps = 30.0;
+  // Keep the animation frames an earlier run wrote.
+  bool resume = false;
+};
+
+void PrintUsage(const char* program) {
+  std::cout << "Usage: " << program << " [options]\n"
+            << "Renders a fractal on the CPU without a display and writes it "
+               "as PNG or PPM.\n\n"
+            << cli::SceneOptionsHelp()
+            << "\nOutput options:\n"
+               "  --output PATH             .png or .ppm file (default "
+               "fractal.png)\n"
+               "  --frames N                render N times and report each "
+               "frame time\n"
+               "  --trace PATH              write per-stage spans as Chrome "
+               "trace JSON\n\n"
+            << cli::RendererOptionsHelp()
+            << "\nAnimation options:\n"
+               "  --keyframes PATH          render the keyframes in PATH (see "
+               "cli/animation.h)\n"
+               "                            as images named after --output, "
+               "e.g. out/%04d.png\n"
+               "  --fps N                   animation frames per second "
+               "(default 30)\n"
+               "  --resume on|off           keep the frames an interrupted run "
+               "wrote\n";
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+  Options options;
+
+  for (int i = 1; i < argc; i += 2) {
+    const std::string key = argv[i];
+    if (i + 1 >= argc) {
+      throw std::invalid_argument(key + " expects a value");
+    }
+    const std::string value = argv[i + 1];
+
+    if (cli::ApplySceneOption(key, value, &options.scene) ||
+        cli::ApplyRendererOption(key, value, &options.renderer)) {
+      continue;
+    }
+
+    if (key == "--output") {
+      options.output = value;
+    } else if (key == "--trace") {
+      options.trace = value;
+    } else if (key == "--frames") {
+      options.frames = std::stoul(value);
+    } else if (key == "--keyframes") {
+      options.keyframes = value;
+    } else if (key == "--fps") {
+      options.fps = std::stod(value);
+      if (!(options.fps > 0.0)) {
+        throw std::invalid_argument(key + " must be positive");
+      }
+    } else if (key == "--resume") {
+      if (value != "on" && value != "off") {
+        throw std::invalid_argument(key + " expects on or off");
+      }
+      options.resume = value == "on";
+    } else {
+      throw std::invalid_argument("unknown option " + key);
+    }
+  }
+
+  cli::FinalizeScene(&options.scene);
+  return options;
+}
+
+// Prints what the renderer counted in its last frame, when asked for.
+void PrintFrameStats(const Options& options,
+                     const render::RenderSettings& settings,
+                     const render::CPURenderer& renderer) {
+  if (options.renderer.subdivision == render::Subdivision2D::kVerify &&
+      render::Is2DFractal(settings.fractal.type)) {
+    std::cout << "  subdivision: " << renderer.subdivision_errors()
+              << " of " << renderer.width() * renderer.height()
+              << " pixels differ from the full render" << std::endl;
+  }
+  if (options.renderer.antialias > 0) {
+    std::cout << "  antialias: " << renderer.antialiased_pixels()
+              << " of " << renderer.width() * renderer.height()
+              << " pixels supersampled" << std::endl;
+  }
+  if (settings.heatmap != render::Heatmap::kOff) {
+    const auto& cost = renderer.cost_stats();
+    std::cout << "  cost: p50 " << cost.p50 << ", p99 " << cost.p99
+              << ", max " << cost.max << ", mean " << cost.mean << std::endl;
+    std::cout << "  histogram:";
+    for (size_t bucket = 0; bucket < cost.histogram.size(); ++bucket) {
+      if (cost.histogram[bucket] > 0) {
+        // Bucket b holds costs in [2^(b-1), 2^b).
+        std::cout << " <" << (uint64_t{1} << bucket) << ":"
+                  << cost.histogram[bucket];
+      }
+    }
+    std::cout << std::endl;
+  }
+}
+
+// Renders the scene options.frames times and writes the last frame.
+void RenderStill(const Options& options, render::CPURenderer* renderer) {
+  const auto& scene = options.scene;
+  double total_ms = 0.0;
+  for (uint32_t frame = 0; frame < options.frames; ++frame) {
+    const auto start = std::chrono::steady_clock::now();
+    renderer->RenderFrame(scene.settings);
+    const auto end = std::chrono::steady_clock::now();
+
+    const double ms =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    total_ms += ms;
+    std::cout << "frame " << frame << ": " << ms << " ms" << std::endl;
+    PrintFrameStats(options, scene.settings, *renderer);
+  }
+  if (options.frames > 1) {
+    std::cout << "average: " << total_ms / options.frames << " ms"
+              << std::endl;
+  }
+  if (options.renderer.tile_cache_bytes > 0 &&
+      render::Is2DFractal(scene.settings.fractal.type)) {
+    const auto stats = renderer->tile_cache_stats();
+    std::cout << "tile cache: " << stats.hits << " hits, " << stats.misses
+              << " misses, " << stats.evictions << " evictions" << std::endl;
+  }
+
+  {
+    render::TraceSpan span("write_image");
+    cli::WriteImage(options.output, renderer->buffer().data(), scene.width,
+                    scene.height);
+  }
+  std::cout << "wrote " << options.output << std::endl;
+}
+
+// `pattern` with its %d or %0Nd replaced by `index`. Patterns without one
+// get the index before their extension, as in fractal_00042.png.
+std::string FramePath(const std::string& pattern, uint32_t index) {
+  std::string number = std::to_string(index);
+  const size_t percent = pattern.find('%');
+  if (percent == std::string::npos) {
+    number.insert(0, number.size() < 5 ? 5 - number.size() : 0, '0');
+    const size_t dot = pattern.rfind('.');
+    const size_t split = dot == std::string::npos ? pattern.size() : dot;
+    return pattern.substr(0, split) + "_" + number + pattern.substr(split);
+  }
+
+  size_t end = percent + 1;
+  while (end < pattern.size() && std::isdigit(pattern[end])) {
+    ++end;
+  }
+  if (end == pattern.size() || pattern[end] != 'd') {
+    throw std::invalid_argument("--output: expected %d or %0Nd in '" +
+                                pattern + "'");
+  }
+  const size_t width =
+      end > percent + 1 ? std::stoul(pattern.substr(percent + 1)) : 0;
+  number.insert(0, number.size() < width ? width - number.size() : 0, '0');
+  return pattern.substr(0, percent) + number + pattern.substr(end + 1);
+}
+
+// Renders the keyframed animation at options.fps. Frame N + 1 renders
+// while the writer thread encodes and writes frame N.
+void RenderAnimation(const Options& options, render::CPURenderer* renderer) {
+  const auto keyframes = cli::ReadKeyframes(options.keyframes, options.scene);
+  const double start = keyframes.front().time;
+  const double duration = keyframes.back().time - start;
+  // The last keyframe gets a frame of its own when it falls on one.
+  const uint32_t frames =
+      static_cast<uint32_t>(std::floor(duration * options.fps + 1e-6)) + 1;
+
+  cli::FrameWriter writer;
+  uint32_t kept = 0;
+  uint32_t rendered = 0;
+  double render_ms = 0.0;
+  // Time spent waiting for the writer to catch up.
+  double stall_ms = 0.0;
+  for (uint32_t frame = 0; frame < frames; ++frame) {
+    const std::string path = FramePath(options.output, frame);
+    // Images are renamed into place once complete, so any that exists is
+    // whole.
+    if (options.resume && std::filesystem::exists(path)) {
+      ++kept;
+      continue;
+    }
+
+    const auto settings =
+        cli::InterpolateKeyframes(keyframes, start + frame / options.fps);
+    const auto render_start = std::chrono::steady_clock::now();
+    renderer->RenderFrame(settings);
+    const auto render_end = std::chrono::steady_clock::now();
+    writer.Write(path, renderer->buffer().data(), renderer->width(),
+                 renderer->height());
+    const auto write_end = std::chrono::steady_clock::now();
+
+    const double ms =
+        std::chrono::duration<double, std::milli>(render_end - render_start)
+            .count();
+    render_ms += ms;
+    stall_ms += std::chrono::duration<double, std::milli>(write_end -
+                                                          render_end)
+                    .count();
+    ++rendered;
+    std::cout << "frame " << frame + 1 << "/" << frames << ": " << ms
+              << " ms -> " << path << std::endl;
+    PrintFrameStats(options, settings, *renderer);
+  }
+
+  const auto finish_start = std::chrono::steady_clock::now();
+  writer.Finish();
+  stall_ms += std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - finish_start)
+                  .count();
+
+  if (kept > 0) {
+    std::cout << "kept " << kept << " frames written before" << std::endl;
+  }
+  if (rendered > 0) {
+    std::cout << "rendered " << rendered << " frames, average "
+              << render_ms / rendered << " ms; waited " << stall_ms
+              << " ms for the writer" << std::endl;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--help") == 0 ||
+        std::strcmp(argv[i], "-h") == 0) {
+      PrintUsage(argv[0]);
+      return 0;
+    }
+  }
+
+  try {
+    const auto options = ParseOptions(argc, argv);
+    const auto& scene = options.scene;
+
+    if (!options.trace.empty()) {
+      render::Tracer::Get().SetThreadName("main");
+      render::Tracer::Get().Start();
+    }
+
+    render::CPURenderer renderer(options.renderer);
+    renderer.Resize(scene.width, scene.height);
+
+    if (options.keyframes.empty()) {
+      RenderStill(options, &renderer);
+    } else {
+      RenderAnimation(options, &renderer);
+    }
+
+    if (!options.trace.empty()) {
+      render::Tracer::Get().Stop();
+      std::ofstream trace(options.trace);
+      if (!trace) {
+        throw std::runtime_error("cannot open " + options.trace);
+      }
+      render::Tracer::Get().WriteChromeJson(trace);
+      std::cout << "wrote " << options.trace << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include "cli/renderer_options.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "cli/scene_options.h"
+
+namespace {
+
+// Upper bounds of the numeric options, far above any useful value; they keep
+// tile arithmetic and the cache size from overflowing.
+constexpr uint32_t kMaxThreads = 1024;
+constexpr uint32_t kMaxTileSize = 4096;
+constexpr uint32_t kMaxAntialias = 256;
+constexpr uint32_t kMaxTileCacheMB = static_cast<uint32_t>(
+    std::min<size_t>(SIZE_MAX >> 20, UINT32_MAX));
+
+bool ParseSwitch(const std::string& key, const std::string& value) {
+  if (value != "on" && value != "off") {
+    throw std::invalid_argument(key + " expects on or off");
+  }
+  return value == "on";
+}
+
+}  // namespace
+
+namespace cli {
+
+bool ApplyRendererOption(const std::string& key, const std::string& value,
+                         render::CPURendererOptions* options) {
+  if (key == "--threads") {
+    options->threads = ParseUint(key, value, 0, kMaxThreads);
+  } else if (key == "--tile") {
+    options->tile_size = ParseUint(key, value, 1, kMaxTileSize);
+  } else if (key == "--depth-reuse") {
+    options->reuse_depth = ParseSwitch(key, value);
+  } else if (key == "--cone-prepass") {
+    options->cone_prepass = ParseSwitch(key, value);
+  } else if (key == "--incremental-pan") {
+    options->incremental_pan = ParseSwitch(key, value);
+  } else if (key == "--tile-cache") {
+    const size_t megabytes = ParseUint(key, value, 0, kMaxTileCacheMB);
+    options->tile_cache_bytes = megabytes << 20;
+  } else if (key == "--normals") {
+    if (value == "central") {
+      options->normals = render::NormalMethod::kCentral;
+    } else if (value == "tetrahedral") {
+      options->normals = render::NormalMethod::kTetrahedral;
+    } else if (value == "dual") {
+      options->normals = render::NormalMethod::kDual;
+    } else {
+      throw std::invalid_argument(key +
+                                  " expects central, tetrahedral or dual");
+    }
+  } else if (key == "--antialias") {
+    options->antialias = ParseUint(key, value, 0, kMaxAntialias);
+  } else if (key == "--subdivide") {
+    if (value == "on") {
+      options->subdivision = render::Subdivision2D::kOn;
+    } else if (value == "off") {
+      options->subdivision = render::Subdivision2D::kOff;
+    } else if (value == "verify") {
+      options->subdivision = render::Subdivision2D::kVerify;
+    } else {
+      throw std::invalid_argument(key + " expects on, off or verify");
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* RendererOptionsHelp() {
+  return "Renderer options:\n"
+         "  --threads N               worker threads (0: all cores)\n"
+         "  --tile N                  tile size in pixels (1 to 4096)\n"
+         "  --depth-reuse on|off      start 3D rays at the previous frame's "
+         "hit depth\n"
+         "                            (default off)\n"
+         "  --cone-prepass on|off     start 3D rays where a cone per 8x8 "
+         "block stopped;\n"
+         "                            faster, but not exact and tile-size "
+         "dependent\n"
+         "                            (default off)\n"
+         "  --incremental-pan on|off  render only what a 2D pan exposed\n"
+         "  --tile-cache MB           memory for 2D tiles kept across frames "
+         "(0: off)\n"
+         "  --normals METHOD          3D normals: central (default), "
+         "tetrahedral or dual\n"
+         "  --antialias N             N extra jittered samples for edge "
+         "pixels (0: off)\n"
+         "  --subdivide on|off|verify iterate only rectangle borders of 2D "
+         "frames\n"
+         "                            (default off); verify also reports "
+         "the\n"
+         "                            pixels this got wrong\n";
+}
+
+}  // namespace cli
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+#include "render/cpu/cpu_renderer.h"
+
+namespace cli {
+
+// Applies `--key value` to `options`. Returns false when `key` is not a CPU
+// renderer option and throws std::invalid_argument when `value` is
+// malformed.
+bool ApplyRendererOption(const std::string& key, const std::string& value,
+                         render::CPURendererOptions* options);
+
+// Help text for the options ApplyRendererOption understands.
+const char* RendererOptionsHelp();
+
+}  // namespace cli
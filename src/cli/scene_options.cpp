@@ -0,0 +1,244 @@
+#include "cli/scene_options.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr const char* kFractalNames[] = {
+    "mandelbrot", "julia", "menger", "mandelbulb", "mandelbox", "juliabulb",
+};
+
+// Indexed by render::Heatmap.
+constexpr const char* kHeatmapNames[] = {"off", "steps", "evaluations"};
+
+std::vector<float> ParseFloats(const std::string& key, const std::string& value,
+                               size_t count) {
+  std::vector<float> result;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    try {
+      size_t used = 0;
+      result.push_back(std::stof(item, &used));
+      if (used != item.size()) {
+        throw std::invalid_argument(item);
+      }
+    } catch (const std::exception&) {
+      throw std::invalid_argument(key + ": '" + value +
+                                  "' is not a number list");
+    }
+  }
+
+  if (result.size() != count) {
+    throw std::invalid_argument(key + " expects " + std::to_string(count) +
+                                " comma-separated values");
+  }
+  return result;
+}
+
+float ParseFloat(const std::string& key, const std::string& value) {
+  return ParseFloats(key, value, 1)[0];
+}
+
+double ParseDouble(const std::string& key, const std::string& value) {
+  try {
+    size_t used = 0;
+    const double result = std::stod(value, &used);
+    if (used == value.size()) {
+      return result;
+    }
+  } catch (const std::exception&) {
+  }
+  throw std::invalid_argument(key + ": '" + value + "' is not a number");
+}
+
+bool ParseBool(const std::string& key, const std::string& value) {
+  if (value == "on" || value == "1") {
+    return true;
+  }
+  if (value == "off" || value == "0") {
+    return false;
+  }
+  throw std::invalid_argument(key + ": expected on or off, got '" + value +
+                              "'");
+}
+
+render::Heatmap ParseHeatmap(const std::string& key,
+                             const std::string& value) {
+  for (size_t i = 0; i < std::size(kHeatmapNames); ++i) {
+    if (value == kHeatmapNames[i]) {
+      return static_cast<render::Heatmap>(i);
+    }
+  }
+  throw std::invalid_argument(key + ": expected off, steps or evaluations, "
+                              "got '" + value + "'");
+}
+
+Vector3d ParseVector(const std::string& key, const std::string& value) {
+  const auto v = ParseFloats(key, value, 3);
+  return {v[0], v[1], v[2]};
+}
+
+}  // namespace
+
+namespace cli {
+
+uint32_t ParseUint(const std::string& key, const std::string& value,
+                   uint32_t min, uint32_t max) {
+  unsigned long long result = 0;
+  try {
+    size_t used = 0;
+    // stoull skips leading spaces and wraps negatives around; take digits
+    // only.
+    if (!value.empty() && value[0] >= '0' && value[0] <= '9') {
+      result = std::stoull(value, &used);
+    }
+    if (used == 0 || used != value.size()) {
+      throw std::invalid_argument(value);
+    }
+  } catch (const std::invalid_argument&) {
+    throw std::invalid_argument(key + ": '" + value +
+                                "' is not a non-negative integer");
+  } catch (const std::out_of_range&) {
+    result = ULLONG_MAX;
+  }
+  if (result < min || result > max) {
+    throw std::invalid_argument(key + " expects " + std::to_string(min) +
+                                " to " + std::to_string(max) + ", got '" +
+                                value + "'");
+  }
+  return static_cast<uint32_t>(result);
+}
+
+render::FractalType ParseFractalType(const std::string& name) {
+  for (size_t i = 0; i < std::size(kFractalNames); ++i) {
+    if (name == kFractalNames[i]) {
+      return static_cast<render::FractalType>(i);
+    }
+  }
+  throw std::invalid_argument("unknown fractal '" + name + "'");
+}
+
+const char* FractalTypeName(render::FractalType type) {
+  const auto index = static_cast<size_t>(type);
+  return index < std::size(kFractalNames) ? kFractalNames[index] : "unknown";
+}
+
+bool ApplySceneOption(const std::string& key, const std::string& value,
+                      SceneOptions* scene) {
+  auto& settings = scene->settings;
+
+  if (key == "--fractal") {
+    // Same reset as SettingsManager::SetFractalType.
+    settings = render::RenderSettings{};
+    settings.fractal.type = ParseFractalType(value);
+  } else if (key == "--width") {
+    scene->width = ParseUint(key, value);
+  } else if (key == "--height") {
+    scene->height = ParseUint(key, value);
+  } else if (key == "--iterations") {
+    settings.fractal.max_iterations = ParseUint(key, value);
+  } else if (key == "--position") {
+    settings.camera.position = ParseVector(key, value);
+    settings.view2d.center_x =
+        render::FixedPoint::FromDouble(settings.camera.position.x);
+    settings.view2d.center_y =
+        render::FixedPoint::FromDouble(settings.camera.position.y);
+  } else if (key == "--direction") {
+    settings.camera.direction = Normalize(ParseVector(key, value));
+  } else if (key == "--scale") {
+    const double scale = ParseDouble(key, value);
+    if (!(scale >= render::View2DSettings::kMinScale)) {
+      throw std::invalid_argument(key + " must be at least 1e-110");
+    }
+    settings.view2d.scale = scale;
+    settings.camera.scale = std::max(scale, static_cast<double>(FLT_MIN));
+  } else if (key == "--center") {
+    const size_t comma = value.find(',');
+    try {
+      if (comma == std::string::npos) {
+        throw std::invalid_argument(value);
+      }
+      settings.view2d.center_x =
+          render::FixedPoint::FromString(value.substr(0, comma));
+      settings.view2d.center_y =
+          render::FixedPoint::FromString(value.substr(comma + 1));
+    } catch (const std::exception&) {
+      throw std::invalid_argument(key + ": '" + value +
+                                  "' is not a RE,IM decimal pair");
+    }
+    settings.camera.position.x = settings.view2d.center_x.ToDouble();
+    settings.camera.position.y = settings.view2d.center_y.ToDouble();
+  } else if (key == "--deep-zoom") {
+    settings.view2d.deep_zoom = ParseBool(key, value);
+  } else if (key == "--heatmap") {
+    settings.heatmap = ParseHeatmap(key, value);
+  } else if (key == "--relaxation") {
+    const float relaxation = ParseFloat(key, value);
+    if (!(relaxation >= 1.0f && relaxation < 2.0f)) {
+      throw std::invalid_argument(key + " must be in [1, 2)");
+    }
+    settings.relaxation = relaxation;
+  } else if (key == "--julia-c") {
+    const auto c = ParseFloats(key, value, 2);
+    settings.fractal.julia.c_re = c[0];
+    settings.fractal.julia.c_im = c[1];
+  } else if (key == "--mandelbulb-power") {
+    settings.fractal.mandelbulb.power = ParseFloat(key, value);
+  } else if (key == "--mandelbulb-bailout") {
+    settings.fractal.mandelbulb.boilout = ParseFloat(key, value);
+  } else if (key == "--mandelbox") {
+    const auto params = ParseFloats(key, value, 3);
+    settings.fractal.mandelbox.min_radius = params[0];
+    settings.fractal.mandelbox.fixed_radius = params[1];
+    settings.fractal.mandelbox.scale = params[2];
+  } else if (key == "--juliabulb-c") {
+    settings.fractal.juliabulb.c = ParseVector(key, value);
+  } else if (key == "--juliabulb-power") {
+    settings.fractal.juliabulb.power = ParseFloat(key, value);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void FinalizeScene(SceneOptions* scene) {
+  if (scene->width == 0 || scene->height == 0) {
+    throw std::invalid_argument("image size must be positive");
+  }
+  scene->settings.camera.aspect =
+      static_cast<float>(scene->width) / scene->height;
+}
+
+const char* SceneOptionsHelp() {
+  return "Scene options:\n"
+         "  --fractal NAME            mandelbrot, julia, menger, mandelbulb,\n"
+         "                            mandelbox or juliabulb (resets the\n"
+         "                            options below, so pass it first)\n"
+         "  --width N, --height N     image size in pixels\n"
+         "  --iterations N            fractal iteration limit\n"
+         "  --position X,Y,Z          camera position (2D: view center)\n"
+         "  --direction X,Y,Z         camera direction\n"
+         "  --scale S                 2D view half-height, down to 1e-110\n"
+         "  --center RE,IM            2D view center as exact decimals, for\n"
+         "                            zooms past double precision\n"
+         "  --deep-zoom on|off        force Mandelbrot perturbation rendering\n"
+         "  --heatmap MODE            off, steps or evaluations: color by the\n"
+         "                            per-pixel cost instead (2D: iterations)\n"
+         "  --relaxation W            over-relax 3D ray steps by W in [1, 2)\n"
+         "                            (default 1; slower on the Menger "
+         "sponge)\n"
+         "  --julia-c RE,IM           Julia constant\n"
+         "  --mandelbulb-power P      Mandelbulb power\n"
+         "  --mandelbulb-bailout B    Mandelbulb bailout radius\n"
+         "  --mandelbox MIN,FIXED,S   Mandelbox radii and scale\n"
+         "  --juliabulb-c X,Y,Z       Juliabulb constant\n"
+         "  --juliabulb-power P       Juliabulb power\n";
+}
+
+}  // namespace cli
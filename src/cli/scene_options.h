@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "render/settings_provider.h"
+
+namespace cli {
+
+// Scene described on the command line: fractal, camera and image size.
+struct SceneOptions {
+  render::RenderSettings settings;
+  uint32_t width = 1280;
+  uint32_t height = 720;
+};
+
+// Parses `value` of option `key` as a decimal integer from `min` to `max`.
+// Throws std::invalid_argument otherwise, signs and overflow included.
+uint32_t ParseUint(const std::string& key, const std::string& value,
+                   uint32_t min = 0, uint32_t max = UINT32_MAX);
+
+render::FractalType ParseFractalType(const std::string& name);
+const char* FractalTypeName(render::FractalType type);
+
+// Applies `--key value` to `scene`. Returns false when `key` is not a scene
+// option and throws std::invalid_argument when `value` is malformed.
+bool ApplySceneOption(const std::string& key, const std::string& value,
+                      SceneOptions* scene);
+
+// Sets the camera aspect from the image size, like the app does on resize.
+void FinalizeScene(SceneOptions* scene);
+
+// Help text for the options ApplySceneOption understands.
+const char* SceneOptionsHelp();
+
+}  // namespace cli
@@ -0,0 +1,323 @@
+#include "farm/coordinator.h"
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+extern char** environ;
+
+namespace farm {
+
+namespace {
+
+// Tiles a worker holds at once.
+constexpr size_t kTilesInFlight = 2;
+// How often the accept loop checks whether the frame is done.
+constexpr int kAcceptPollMs = 100;
+// How long workers get to exit once their connection is closed.
+constexpr auto kExitGrace = std::chrono::seconds(2);
+
+// The tiles of a frame and who holds them, and the frame they are merged
+// into. Shared by the connection threads.
+class TileScheduler {
+ public:
+  TileScheduler(uint32_t width, uint32_t height, uint32_t tile_size)
+      : width_(width), frame_(static_cast<size_t>(width) * height) {
+    for (uint32_t y = 0; y < height; y += tile_size) {
+      for (uint32_t x = 0; x < width; x += tile_size) {
+        const uint32_t id = tiles_.size();
+        Tile& tile = tiles_.emplace_back();
+        tile.message = {id, x, y, std::min(tile_size, width - x),
+                        std::min(tile_size, height - y)};
+        pending_.push_back(id);
+      }
+    }
+    remaining_ = tiles_.size();
+  }
+
+  // The next tile for `worker`, which it then holds: a tile no one holds,
+  // or with `speculate`, a copy of the one held longest by fewest others.
+  // Returns nullopt when there is none; with `speculate`, that means every
+  // tile is done, as a speculating worker holds none.
+  std::optional<TileMessage> Next(uint32_t worker, bool speculate) {
+    std::lock_guard lock(mutex_);
+    uint32_t id;
+    if (!pending_.empty()) {
+      id = pending_.front();
+      pending_.pop_front();
+      tiles_[id].issued = ++issued_;
+    } else if (speculate) {
+      const Tile* best = nullptr;
+      for (const Tile& tile : tiles_) {
+        if (tile.done || tile.holders.empty()) {
+          continue;
+        }
+        if (!best || tile.holders.size() < best->holders.size() ||
+            (tile.holders.size() == best->holders.size() &&
+             tile.issued < best->issued)) {
+          best = &tile;
+        }
+      }
+      if (!best) {
+        return std::nullopt;
+      }
+      id = best->message.id;
+    } else {
+      return std::nullopt;
+    }
+    tiles_[id].holders.push_back(worker);
+    return tiles_[id].message;
+  }
+
+  const TileMessage& tile(uint32_t id) const { return tiles_[id].message; }
+
+  // Takes the pixels `worker` rendered for tile `id`. Returns false if
+  // another worker's copy arrived first.
+  bool Complete(uint32_t worker, uint32_t id,
+                const std::vector<Color>& pixels) {
+    std::lock_guard lock(mutex_);
+    Tile& tile = tiles_[id];
+    std::erase(tile.holders, worker);
+    if (tile.done) {
+      return false;
+    }
+
+    const TileMessage& message = tile.message;
+    for (uint32_t y = 0; y < message.height; ++y) {
+      std::copy_n(&pixels[y * message.width], message.width,
+                  &frame_[(message.y + y) * width_ + message.x]);
+    }
+    tile.done = true;
+    if (--remaining_ == 0) {
+      done_.notify_all();
+    }
+    return true;
+  }
+
+  // Takes back the tiles of `worker`, which dropped out. Those no other
+  // worker holds go back to the queue.
+  void Drop(uint32_t worker) {
+    std::lock_guard lock(mutex_);
+    for (Tile& tile : tiles_) {
+      if (std::erase(tile.holders, worker) > 0 && !tile.done &&
+          tile.holders.empty()) {
+        pending_.push_back(tile.message.id);
+        ++requeued_;
+      }
+    }
+  }
+
+  // Waits up to `timeout` for every tile to be done.
+  bool WaitDone(std::chrono::milliseconds timeout) {
+    std::unique_lock lock(mutex_);
+    return done_.wait_for(lock, timeout, [this] { return remaining_ == 0; });
+  }
+
+  uint32_t remaining() {
+    std::lock_guard lock(mutex_);
+    return remaining_;
+  }
+
+  uint32_t tile_count() const { return tiles_.size(); }
+
+  // Tiles Drop put back in the queue.
+  uint32_t requeued() {
+    std::lock_guard lock(mutex_);
+    return requeued_;
+  }
+
+  // Only read once every tile is done.
+  std::vector<Color>& frame() { return frame_; }
+
+ private:
+  struct Tile {
+    TileMessage message;
+    bool done = false;
+    // Workers rendering the tile.
+    std::vector<uint32_t> holders;
+    // When it was first handed out, for picking copies.
+    uint64_t issued = 0;
+  };
+
+  const uint32_t width_;
+  std::vector<Tile> tiles_;
+
+  std::mutex mutex_;
+  std::condition_variable done_;
+  std::deque<uint32_t> pending_;
+  uint32_t remaining_ = 0;
+  uint32_t requeued_ = 0;
+  uint64_t issued_ = 0;
+  std::vector<Color> frame_;
+};
+
+// Feeds tiles to the worker on `socket` until every tile is done or the
+// worker fails. Throws on failure.
+void Serve(Socket* socket, uint32_t worker, const FrameMessage& frame,
+           TileScheduler* scheduler, WorkerStats* stats) {
+  Send(socket, frame);
+
+  std::deque<uint32_t> in_flight;
+  while (true) {
+    // Only a worker with nothing to do renders copies; the others keep to
+    // the queue.
+    while (in_flight.size() < kTilesInFlight) {
+      const auto tile = scheduler->Next(worker, in_flight.empty());
+      if (!tile) {
+        break;
+      }
+      Send(socket, *tile);
+      in_flight.push_back(tile->id);
+    }
+    if (in_flight.empty()) {
+      return;
+    }
+
+    PixelsMessage pixels;
+    if (!Receive(socket, &pixels)) {
+      throw std::runtime_error("worker disconnected");
+    }
+    const auto held = std::find(in_flight.begin(), in_flight.end(), pixels.id);
+    if (held == in_flight.end()) {
+      throw std::runtime_error("worker sent a tile it was not given");
+    }
+    const TileMessage& tile = scheduler->tile(pixels.id);
+    if (pixels.pixels.size() != size_t{tile.width} * tile.height) {
+      throw std::runtime_error("worker sent a tile of the wrong size");
+    }
+    in_flight.erase(held);
+
+    if (scheduler->Complete(worker, pixels.id, pixels.pixels)) {
+      ++stats->tiles;
+    } else {
+      ++stats->wasted;
+    }
+  }
+}
+
+}  // namespace
+
+Coordinator::Coordinator(const CoordinatorOptions& options)
+    : options_(options), listener_(options.port, options.remote) {}
+
+Coordinator::~Coordinator() {
+  CloseConnections();
+
+  // Workers exit once their connection is closed; those that don't, say
+  // because they are stopped, are killed.
+  const auto deadline = std::chrono::steady_clock::now() + kExitGrace;
+  for (const pid_t child : children_) {
+    while (waitpid(child, nullptr, WNOHANG) == 0) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+void Coordinator::Spawn(const std::vector<std::string>& command) {
+  std::vector<std::string> args = command;
+  args.push_back("--worker");
+  args.push_back("127.0.0.1:" + std::to_string(port()));
+  std::vector<char*> argv;
+  for (auto& arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  pid_t child;
+  const int error =
+      posix_spawnp(&child, argv[0], nullptr, nullptr, argv.data(), environ);
+  if (error != 0) {
+    throw std::runtime_error("cannot start " + args[0] + ": " +
+                             std::strerror(error));
+  }
+  children_.push_back(child);
+}
+
+std::vector<Color> Coordinator::Render(const FrameMessage& frame,
+                                       uint32_t width, uint32_t height) {
+  TileScheduler scheduler(width, height, std::max(options_.tile_size, 1u));
+  stats_ = FarmStats{};
+  stats_.tiles = scheduler.tile_count();
+
+  struct CloseGuard {
+    Coordinator* coordinator;
+    ~CloseGuard() { coordinator->CloseConnections(); }
+  } close_guard{this};
+
+  auto idle_since = std::chrono::steady_clock::now();
+  while (!scheduler.WaitDone(std::chrono::milliseconds(0))) {
+    Socket socket = listener_.Accept(kAcceptPollMs);
+    if (socket.valid()) {
+      auto connection = std::make_unique<Connection>();
+      connection->socket = std::move(socket);
+      connection->stats.name = connection->socket.PeerName();
+      const uint32_t worker = connections_.size();
+      Connection* raw = connection.get();
+      connection->thread = std::thread([=, this, &frame, &scheduler] {
+        try {
+          Serve(&raw->socket, worker, frame, &scheduler, &raw->stats);
+        } catch (const std::exception& e) {
+          if (scheduler.remaining() > 0) {
+            raw->stats.lost = e.what();
+          }
+        }
+        scheduler.Drop(worker);
+        raw->running = false;
+      });
+      connections_.push_back(std::move(connection));
+    }
+
+    const bool connected = std::any_of(
+        connections_.begin(), connections_.end(),
+        [](const auto& connection) { return connection->running.load(); });
+    const auto now = std::chrono::steady_clock::now();
+    if (connected) {
+      idle_since = now;
+    } else if (std::chrono::duration<double>(now - idle_since).count() >
+               options_.idle_timeout_s) {
+      throw std::runtime_error(
+          "no worker connected for " +
+          std::to_string(static_cast<int>(options_.idle_timeout_s)) +
+          " s with " + std::to_string(scheduler.remaining()) + " of " +
+          std::to_string(scheduler.tile_count()) + " tiles left");
+    }
+  }
+
+  CloseConnections();
+  stats_.reissued = scheduler.requeued();
+  for (const auto& connection : connections_) {
+    stats_.workers.push_back(connection->stats);
+  }
+  return std::move(scheduler.frame());
+}
+
+const FarmStats& Coordinator::stats() const { return stats_; }
+uint16_t Coordinator::port() const { return listener_.port(); }
+
+void Coordinator::CloseConnections() {
+  for (const auto& connection : connections_) {
+    connection->socket.Shutdown();
+  }
+  for (const auto& connection : connections_) {
+    if (connection->thread.joinable()) {
+      connection->thread.join();
+    }
+  }
+}
+
+}  // namespace farm
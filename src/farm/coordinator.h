@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "farm/protocol.h"
+#include "farm/socket.h"
+#include "render/common/types.h"
+
+namespace farm {
+
+struct CoordinatorOptions {
+  // Port workers connect to, 0 for any free one.
+  uint16_t port = 0;
+  // Accept workers from other machines, not only from this one.
+  bool remote = false;
+  // Side of the square tiles handed to workers.
+  uint32_t tile_size = 256;
+  // Give up on a frame when no worker has been connected for this long.
+  double idle_timeout_s = 30.0;
+};
+
+struct WorkerStats {
+  std::string name;
+  // Tiles whose pixels went into the frame.
+  uint32_t tiles = 0;
+  // Tiles another worker delivered first.
+  uint32_t wasted = 0;
+  // Why the worker dropped out before the frame was done, if it did.
+  std::string lost;
+};
+
+struct FarmStats {
+  std::vector<WorkerStats> workers;
+  uint32_t tiles = 0;
+  // Tiles handed out again because the worker holding them dropped out.
+  uint32_t reissued = 0;
+};
+
+// Splits frames into tiles and hands them to worker processes connected
+// over TCP, each running RunWorker, then merges the tiles they send back.
+//
+// Each worker holds up to two tiles, so it renders the next while the last
+// one's pixels are in transit. Tiles of a worker that disconnects go back
+// to the queue. Once the queue is empty, idle workers also render copies of
+// the tiles others still hold, longest held first, and the first copy to
+// arrive is kept: a slow or hung worker delays the frame by at most one
+// tile of a faster one.
+class Coordinator {
+ public:
+  // Starts listening; workers may connect from then on. Throws
+  // std::runtime_error if the port is taken.
+  explicit Coordinator(const CoordinatorOptions& options);
+  // Stops the workers it started, killing those that do not exit.
+  ~Coordinator();
+
+  Coordinator(const Coordinator&) = delete;
+  Coordinator& operator=(const Coordinator&) = delete;
+
+  // Starts a worker process on this machine: `command` followed by
+  // --worker 127.0.0.1:PORT. command[0] is looked up like a shell does.
+  void Spawn(const std::vector<std::string>& command);
+
+  // Renders the width x height frame `frame` describes on the workers that
+  // connect, and returns its pixels. Closing the connections at the end
+  // stops the workers, so it is called once. Throws std::runtime_error when
+  // no worker was connected for idle_timeout_s.
+  std::vector<Color> Render(const FrameMessage& frame, uint32_t width,
+                            uint32_t height);
+
+  // Counts of the Render.
+  const FarmStats& stats() const;
+  uint16_t port() const;
+
+ private:
+  struct Connection {
+    Socket socket;
+    std::thread thread;
+    std::atomic<bool> running = true;
+    WorkerStats stats;
+  };
+
+  // Closes every connection and waits for their threads.
+  void CloseConnections();
+
+  const CoordinatorOptions options_;
+  Listener listener_;
+  std::vector<pid_t> children_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  FarmStats stats_;
+};
+
+}  // namespace farm
@@ -0,0 +1,208 @@
+#include <signal.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "cli/image_writer.h"
+#include "cli/renderer_options.h"
+#include "cli/scene_options.h"
+#include "farm/coordinator.h"
+#include "farm/worker.h"
+
+namespace {
+
+// Bound on --threads and --spawn, as --threads is bounded for the renderer.
+constexpr uint32_t kMaxThreads = 1024;
+
+struct Options {
+  cli::SceneOptions scene;
+  render::CPURendererOptions renderer;
+  farm::FrameMessage frame;
+  std::string output = "fractal.png";
+  farm::CoordinatorOptions coordinator;
+  uint32_t spawn = 0;
+  // Threads of each spawned worker, 0 to share the cores among them.
+  uint32_t threads = 0;
+  // Run as a worker of the coordinator at this address instead.
+  std::string worker;
+};
+
+void PrintUsage(const char* program) {
+  std::cout << "Usage: " << program << " [options]\n"
+            << "Renders one frame split into tiles across worker processes "
+               "and writes it\n"
+               "as PNG or PPM.\n\n"
+            << cli::SceneOptionsHelp() << "\n"
+            << cli::RendererOptionsHelp()
+            << "\nFarm options:\n"
+               "  --output PATH             .png or .ppm file (default "
+               "fractal.png)\n"
+               "  --spawn N                 start N workers on this machine\n"
+               "  --listen PORT             also accept workers from other "
+               "machines on PORT\n"
+               "  --farm-tile N             side of the tiles handed to "
+               "workers (default 256)\n"
+               "  --idle-timeout S          give up after S seconds without "
+               "workers (default 30)\n"
+               "  --threads N               render threads of each spawned "
+               "worker\n"
+               "                            (default: the cores shared among "
+               "them)\n"
+               "\nWorker mode:\n"
+               "  --worker HOST:PORT        render tiles for the coordinator "
+               "at HOST:PORT;\n"
+               "                            only --threads may be given "
+               "too\n";
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+  Options options;
+  bool listen = false;
+
+  for (int i = 1; i < argc; i += 2) {
+    const std::string key = argv[i];
+    if (i + 1 >= argc) {
+      throw std::invalid_argument(key + " expects a value");
+    }
+    const std::string value = argv[i + 1];
+
+    if (key == "--threads") {
+      options.threads = cli::ParseUint(key, value, 0, kMaxThreads);
+    } else if (cli::ApplySceneOption(key, value, &options.scene)) {
+      options.frame.scene.emplace_back(key, value);
+    } else if (cli::ApplyRendererOption(key, value, &options.renderer)) {
+      options.frame.renderer.emplace_back(key, value);
+    } else if (key == "--output") {
+      options.output = value;
+    } else if (key == "--spawn") {
+      options.spawn = cli::ParseUint(key, value, 0, kMaxThreads);
+    } else if (key == "--listen") {
+      options.coordinator.port =
+          static_cast<uint16_t>(cli::ParseUint(key, value, 0, 65535));
+      options.coordinator.remote = true;
+      listen = true;
+    } else if (key == "--farm-tile") {
+      options.coordinator.tile_size = cli::ParseUint(key, value, 1);
+    } else if (key == "--idle-timeout") {
+      options.coordinator.idle_timeout_s = std::stod(value);
+    } else if (key == "--worker") {
+      options.worker = value;
+    } else {
+      throw std::invalid_argument("unknown option " + key);
+    }
+  }
+
+  if (!options.worker.empty()) {
+    if (argc - 1 != (options.threads > 0 ? 4 : 2)) {
+      throw std::invalid_argument(
+          "--worker takes its frame from the coordinator; only --threads "
+          "may be given too");
+    }
+    return options;
+  }
+
+  cli::FinalizeScene(&options.scene);
+  if (options.scene.settings.heatmap != render::Heatmap::kOff) {
+    throw std::invalid_argument(
+        "heatmaps are scaled per tile; render them with fractal_cli");
+  }
+  if (options.spawn == 0 && !listen) {
+    throw std::invalid_argument("no workers: pass --spawn N or --listen PORT");
+  }
+  if (options.coordinator.tile_size == 0) {
+    throw std::invalid_argument("--farm-tile must be positive");
+  }
+  return options;
+}
+
+// This executable, to start workers with.
+std::string WorkerProgram(const char* argv0) {
+  std::error_code error;
+  const auto self = std::filesystem::read_symlink("/proc/self/exe", error);
+  return error ? argv0 : self.string();
+}
+
+void RunCoordinator(const Options& options, const char* argv0) {
+  farm::Coordinator coordinator(options.coordinator);
+  if (options.coordinator.remote) {
+    std::cout << "listening on port " << coordinator.port() << std::endl;
+  }
+
+  const uint32_t threads =
+      options.threads > 0 || options.spawn == 0
+          ? options.threads
+          : std::max(std::thread::hardware_concurrency() / options.spawn, 1u);
+  for (uint32_t i = 0; i < options.spawn; ++i) {
+    coordinator.Spawn(
+        {WorkerProgram(argv0), "--threads", std::to_string(threads)});
+  }
+
+  const auto& scene = options.scene;
+  const auto start = std::chrono::steady_clock::now();
+  const auto pixels =
+      coordinator.Render(options.frame, scene.width, scene.height);
+  const auto end = std::chrono::steady_clock::now();
+
+  const auto& stats = coordinator.stats();
+  std::cout << "frame: "
+            << std::chrono::duration<double, std::milli>(end - start).count()
+            << " ms, " << stats.tiles << " tiles" << std::endl;
+  for (const auto& worker : stats.workers) {
+    std::cout << "  worker " << worker.name << ": " << worker.tiles
+              << " tiles";
+    if (worker.wasted > 0) {
+      std::cout << ", " << worker.wasted << " beaten to it";
+    }
+    if (!worker.lost.empty()) {
+      std::cout << ", lost: " << worker.lost;
+    }
+    std::cout << std::endl;
+  }
+  if (stats.reissued > 0) {
+    std::cout << "  reissued " << stats.reissued
+              << " tiles of lost workers" << std::endl;
+  }
+
+  cli::WriteImage(options.output, pixels.data(), scene.width, scene.height);
+  std::cout << "wrote " << options.output << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--help") == 0 ||
+        std::strcmp(argv[i], "-h") == 0) {
+      PrintUsage(argv[0]);
+      return 0;
+    }
+  }
+
+  // A peer that went away fails the send instead of killing the process.
+  signal(SIGPIPE, SIG_IGN);
+
+  try {
+    const auto options = ParseOptions(argc, argv);
+    if (options.worker.empty()) {
+      RunCoordinator(options, argv[0]);
+    } else {
+      farm::WorkerOptions worker;
+      farm::ParseAddress(options.worker, &worker.host, &worker.port);
+      if (options.threads > 0) {
+        worker.threads = options.threads;
+      }
+      farm::RunWorker(worker);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
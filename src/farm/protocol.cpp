@@ -0,0 +1,213 @@
+#include "farm/protocol.h"
+
+#include <stdexcept>
+
+namespace farm {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4d524146;  // "FARM"
+// Larger payloads are taken for garbage rather than allocated.
+constexpr uint32_t kMaxPayload = uint32_t{1} << 30;
+
+enum class MessageType : uint32_t {
+  kFrame = 1,
+  kTile = 2,
+  kPixels = 3,
+};
+
+class Writer {
+ public:
+  void Put(uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      bytes_.push_back(static_cast<uint8_t>(value >> shift));
+    }
+  }
+
+  void Put(const std::string& value) {
+    Put(static_cast<uint32_t>(value.size()));
+    bytes_.insert(bytes_.end(), value.begin(), value.end());
+  }
+
+  void Put(const OptionList& options) {
+    Put(static_cast<uint32_t>(options.size()));
+    for (const auto& [key, value] : options) {
+      Put(key);
+      Put(value);
+    }
+  }
+
+  void Put(const std::vector<Color>& pixels) {
+    Put(static_cast<uint32_t>(pixels.size()));
+    for (const Color& pixel : pixels) {
+      bytes_.insert(bytes_.end(), {pixel.r, pixel.g, pixel.b, pixel.a});
+    }
+  }
+
+  // Sends the header and the payload put so far.
+  void Send(Socket* socket, MessageType type) {
+    Writer header;
+    header.Put(kMagic);
+    header.Put(static_cast<uint32_t>(type));
+    header.Put(static_cast<uint32_t>(bytes_.size()));
+    socket->SendAll(header.bytes_.data(), header.bytes_.size());
+    socket->SendAll(bytes_.data(), bytes_.size());
+  }
+
+ private:
+  std::vector<uint8_t> bytes_;
+};
+
+class Reader {
+ public:
+  // Receives a message of `type`. Returns false on a clean close.
+  bool Receive(Socket* socket, MessageType type) {
+    uint8_t header[12];
+    if (!socket->ReceiveAll(header, sizeof(header))) {
+      return false;
+    }
+    bytes_.assign(header, header + sizeof(header));
+    position_ = 0;
+    if (Get32() != kMagic) {
+      throw std::runtime_error("not a farm message");
+    }
+    if (Get32() != static_cast<uint32_t>(type)) {
+      throw std::runtime_error("unexpected farm message type");
+    }
+    const uint32_t size = Get32();
+    if (size > kMaxPayload) {
+      throw std::runtime_error("farm message too large");
+    }
+
+    bytes_.resize(size);
+    position_ = 0;
+    if (size > 0 && !socket->ReceiveAll(bytes_.data(), size)) {
+      throw std::runtime_error("connection closed mid-message");
+    }
+    return true;
+  }
+
+  uint32_t Get32() {
+    Need(4);
+    uint32_t value = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      value |= uint32_t{bytes_[position_++]} << shift;
+    }
+    return value;
+  }
+
+  std::string GetString() {
+    const uint32_t size = Get32();
+    Need(size);
+    std::string value(bytes_.begin() + position_,
+                      bytes_.begin() + position_ + size);
+    position_ += size;
+    return value;
+  }
+
+  OptionList GetOptions() {
+    const uint32_t count = Get32();
+    // Each option takes at least its two string sizes; checked before the
+    // list is sized, so a bad count cannot allocate beyond the message.
+    Need(size_t{count} * 8);
+    OptionList options(count);
+    for (auto& [key, value] : options) {
+      key = GetString();
+      value = GetString();
+    }
+    return options;
+  }
+
+  std::vector<Color> GetPixels() {
+    const uint32_t count = Get32();
+    Need(size_t{count} * 4);
+    std::vector<Color> pixels(count);
+    for (Color& pixel : pixels) {
+      pixel = {bytes_[position_], bytes_[position_ + 1],
+               bytes_[position_ + 2], bytes_[position_ + 3]};
+      position_ += 4;
+    }
+    return pixels;
+  }
+
+  // Throws unless the whole payload was read.
+  void End() const {
+    if (position_ != bytes_.size()) {
+      throw std::runtime_error("farm message has trailing bytes");
+    }
+  }
+
+ private:
+  void Need(size_t count) const {
+    if (count > bytes_.size() - position_) {
+      throw std::runtime_error("truncated farm message");
+    }
+  }
+
+  std::vector<uint8_t> bytes_;
+  size_t position_ = 0;
+};
+
+}  // namespace
+
+void Send(Socket* socket, const FrameMessage& message) {
+  Writer writer;
+  writer.Put(message.scene);
+  writer.Put(message.renderer);
+  writer.Send(socket, MessageType::kFrame);
+}
+
+void Send(Socket* socket, const TileMessage& message) {
+  Writer writer;
+  writer.Put(message.id);
+  writer.Put(message.x);
+  writer.Put(message.y);
+  writer.Put(message.width);
+  writer.Put(message.height);
+  writer.Send(socket, MessageType::kTile);
+}
+
+void Send(Socket* socket, const PixelsMessage& message) {
+  Writer writer;
+  writer.Put(message.id);
+  writer.Put(message.pixels);
+  writer.Send(socket, MessageType::kPixels);
+}
+
+bool Receive(Socket* socket, FrameMessage* message) {
+  Reader reader;
+  if (!reader.Receive(socket, MessageType::kFrame)) {
+    return false;
+  }
+  message->scene = reader.GetOptions();
+  message->renderer = reader.GetOptions();
+  reader.End();
+  return true;
+}
+
+bool Receive(Socket* socket, TileMessage* message) {
+  Reader reader;
+  if (!reader.Receive(socket, MessageType::kTile)) {
+    return false;
+  }
+  message->id = reader.Get32();
+  message->x = reader.Get32();
+  message->y = reader.Get32();
+  message->width = reader.Get32();
+  message->height = reader.Get32();
+  reader.End();
+  return true;
+}
+
+bool Receive(Socket* socket, PixelsMessage* message) {
+  Reader reader;
+  if (!reader.Receive(socket, MessageType::kPixels)) {
+    return false;
+  }
+  message->id = reader.Get32();
+  message->pixels = reader.GetPixels();
+  reader.End();
+  return true;
+}
+
+}  // namespace farm
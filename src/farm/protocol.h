@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "farm/socket.h"
+#include "render/common/types.h"
+
+namespace farm {
+
+// Options as `--key value` pairs.
+using OptionList = std::vector<std::pair<std::string, std::string>>;
+
+// Coordinator to worker, first on every connection: the frame to render
+// tiles of, as the command-line options that describe it. Options travel
+// instead of RenderSettings so workers on other machines parse them into
+// the same settings.
+struct FrameMessage {
+  // Scene options, including --width and --height.
+  OptionList scene;
+  // CPU renderer options; the worker's own --threads overrides these.
+  OptionList renderer;
+};
+
+// Coordinator to worker: render the width x height pixels at (x, y).
+struct TileMessage {
+  uint32_t id;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+// Worker to coordinator: the pixels of tile `id`, row by row.
+struct PixelsMessage {
+  uint32_t id;
+  std::vector<Color> pixels;
+};
+
+// Each message is a header of a magic number, its type and its payload
+// size, then the payload; integers are little-endian whatever the machine.
+// Receive returns false if the peer closed the connection between messages
+// and throws std::runtime_error on anything malformed or unexpected.
+void Send(Socket* socket, const FrameMessage& message);
+void Send(Socket* socket, const TileMessage& message);
+void Send(Socket* socket, const PixelsMessage& message);
+bool Receive(Socket* socket, FrameMessage* message);
+bool Receive(Socket* socket, TileMessage* message);
+bool Receive(Socket* socket, PixelsMessage* message);
+
+}  // namespace farm
@@ -0,0 +1,214 @@
+#include "farm/socket.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace farm {
+
+namespace {
+
+[[noreturn]] void ThrowErrno(const std::string& what) {
+  throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// Keeps `fd` from leaking into the worker processes a coordinator starts.
+void CloseOnExec(int fd) { fcntl(fd, F_SETFD, FD_CLOEXEC); }
+
+}  // namespace
+
+Socket::Socket(int fd) : fd_(fd) {
+  CloseOnExec(fd_);
+  // Tile requests are small and answered at once; don't hold them back.
+  const int on = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+Socket::~Socket() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+Socket::Socket(Socket&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)) {}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+  if (this != &other) {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = std::exchange(other.fd_, -1);
+  }
+  return *this;
+}
+
+Socket Socket::Connect(const std::string& host, uint16_t port) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  const int status = getaddrinfo(host.c_str(), std::to_string(port).c_str(),
+                                 &hints, &addresses);
+  if (status != 0) {
+    throw std::runtime_error(host + ": " + gai_strerror(status));
+  }
+
+  int error = 0;
+  for (addrinfo* address = addresses; address; address = address->ai_next) {
+    const int fd = socket(address->ai_family, address->ai_socktype,
+                          address->ai_protocol);
+    if (fd < 0) {
+      error = errno;
+      continue;
+    }
+    if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+      freeaddrinfo(addresses);
+      return Socket(fd);
+    }
+    error = errno;
+    close(fd);
+  }
+  freeaddrinfo(addresses);
+  errno = error;
+  ThrowErrno("cannot connect to " + host + ":" + std::to_string(port));
+}
+
+void Socket::SendAll(const void* data, size_t size) {
+  const auto* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    const ssize_t sent = send(fd_, bytes, size, 0);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowErrno("send");
+    }
+    bytes += sent;
+    size -= sent;
+  }
+}
+
+bool Socket::ReceiveAll(void* data, size_t size) {
+  auto* bytes = static_cast<char*>(data);
+  size_t received = 0;
+  while (received < size) {
+    const ssize_t count = recv(fd_, bytes + received, size - received, 0);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowErrno("recv");
+    }
+    if (count == 0) {
+      if (received == 0) {
+        return false;
+      }
+      throw std::runtime_error("connection closed mid-message");
+    }
+    received += count;
+  }
+  return true;
+}
+
+std::string Socket::PeerName() const {
+  sockaddr_storage address{};
+  socklen_t length = sizeof(address);
+  if (getpeername(fd_, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+    return "?";
+  }
+  char host[NI_MAXHOST];
+  char port[NI_MAXSERV];
+  if (getnameinfo(reinterpret_cast<sockaddr*>(&address), length, host,
+                  sizeof(host), port, sizeof(port),
+                  NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+    return "?";
+  }
+  return std::string(host) + ":" + port;
+}
+
+void Socket::Shutdown() {
+  if (fd_ >= 0) {
+    shutdown(fd_, SHUT_RDWR);
+  }
+}
+
+Listener::Listener(uint16_t port, bool any_interface) {
+  fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    ThrowErrno("socket");
+  }
+  CloseOnExec(fd_);
+  const int on = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(any_interface ? INADDR_ANY
+                                                : INADDR_LOOPBACK);
+  if (bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+          0 ||
+      listen(fd_, SOMAXCONN) < 0) {
+    const int error = errno;
+    close(fd_);
+    errno = error;
+    ThrowErrno("cannot listen on port " + std::to_string(port));
+  }
+
+  socklen_t length = sizeof(address);
+  getsockname(fd_, reinterpret_cast<sockaddr*>(&address), &length);
+  port_ = ntohs(address.sin_port);
+}
+
+Listener::~Listener() { close(fd_); }
+
+Socket Listener::Accept(int timeout_ms) {
+  pollfd entry{fd_, POLLIN, 0};
+  const int ready = poll(&entry, 1, timeout_ms);
+  if (ready < 0 && errno != EINTR) {
+    ThrowErrno("poll");
+  }
+  if (ready <= 0) {
+    return Socket();
+  }
+
+  const int fd = accept(fd_, nullptr, nullptr);
+  if (fd < 0) {
+    if (errno == EINTR || errno == ECONNABORTED) {
+      return Socket();
+    }
+    ThrowErrno("accept");
+  }
+  return Socket(fd);
+}
+
+void ParseAddress(const std::string& address, std::string* host,
+                  uint16_t* port) {
+  const size_t colon = address.rfind(':');
+  if (colon == std::string::npos || colon == 0) {
+    throw std::invalid_argument("'" + address + "' is not HOST:PORT");
+  }
+  try {
+    size_t used = 0;
+    const unsigned long value = std::stoul(address.substr(colon + 1), &used);
+    if (used != address.size() - colon - 1 || value == 0 || value > 65535) {
+      throw std::invalid_argument(address);
+    }
+    *port = static_cast<uint16_t>(value);
+  } catch (const std::exception&) {
+    throw std::invalid_argument("'" + address + "' has no valid port");
+  }
+  *host = address.substr(0, colon);
+}
+
+}  // namespace farm
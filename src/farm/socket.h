@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace farm {
+
+// A connected TCP stream socket, closed on destruction. Errors throw
+// std::runtime_error.
+class Socket {
+ public:
+  Socket() = default;
+  explicit Socket(int fd);
+  ~Socket();
+
+  Socket(Socket&& other) noexcept;
+  Socket& operator=(Socket&& other) noexcept;
+  Socket(const Socket&) = delete;
+  Socket& operator=(const Socket&) = delete;
+
+  // Connects to `host`, a name or an address, at `port`.
+  static Socket Connect(const std::string& host, uint16_t port);
+
+  void SendAll(const void* data, size_t size);
+  // Fills `data` with `size` bytes. Returns false if the peer closed the
+  // connection before the first byte; throws if it did so midway.
+  bool ReceiveAll(void* data, size_t size);
+  // Ends both directions of the connection, which wakes up a thread
+  // blocked on it in another call. Safe to call from any thread.
+  void Shutdown();
+
+  // "address:port" of the peer, for messages.
+  std::string PeerName() const;
+
+  bool valid() const { return fd_ >= 0; }
+
+ private:
+  int fd_ = -1;
+};
+
+// A TCP socket listening for connections, closed on destruction.
+class Listener {
+ public:
+  // Listens on `port` of the loopback interface, or of every interface
+  // when `any_interface`. Port 0 picks a free one.
+  Listener(uint16_t port, bool any_interface);
+  ~Listener();
+
+  Listener(const Listener&) = delete;
+  Listener& operator=(const Listener&) = delete;
+
+  // Waits up to `timeout_ms` for a connection. Returns an invalid Socket if
+  // none came.
+  Socket Accept(int timeout_ms);
+
+  uint16_t port() const { return port_; }
+
+ private:
+  int fd_ = -1;
+  uint16_t port_ = 0;
+};
+
+// Splits "HOST:PORT". Throws std::invalid_argument when malformed.
+void ParseAddress(const std::string& address, std::string* host,
+                  uint16_t* port);
+
+}  // namespace farm
@@ -0,0 +1,99 @@
+#include "farm/worker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "cli/renderer_options.h"
+#include "cli/scene_options.h"
+#include "farm/protocol.h"
+#include "farm/socket.h"
+#include "render/cpu/cpu_renderer.h"
+
+namespace farm {
+
+namespace {
+
+constexpr auto kConnectRetry = std::chrono::milliseconds(250);
+
+Socket ConnectWithRetry(const WorkerOptions& options) {
+  const auto deadline =
+      std::chrono::steady_clock::now() +
+      std::chrono::duration<double>(options.connect_timeout_s);
+  while (true) {
+    try {
+      return Socket::Connect(options.host, options.port);
+    } catch (const std::runtime_error&) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        throw;
+      }
+    }
+    std::this_thread::sleep_for(kConnectRetry);
+  }
+}
+
+}  // namespace
+
+void RunWorker(const WorkerOptions& options) {
+  Socket socket = ConnectWithRetry(options);
+
+  FrameMessage frame;
+  if (!Receive(&socket, &frame)) {
+    return;
+  }
+  cli::SceneOptions scene;
+  for (const auto& [key, value] : frame.scene) {
+    if (!cli::ApplySceneOption(key, value, &scene)) {
+      throw std::runtime_error("unknown scene option " + key);
+    }
+  }
+  cli::FinalizeScene(&scene);
+  render::CPURendererOptions renderer_options;
+  for (const auto& [key, value] : frame.renderer) {
+    if (!cli::ApplyRendererOption(key, value, &renderer_options)) {
+      throw std::runtime_error("unknown renderer option " + key);
+    }
+  }
+  if (options.threads) {
+    renderer_options.threads = *options.threads;
+  }
+  render::CPURenderer renderer(renderer_options);
+  const uint32_t apron = renderer_options.antialias > 0 ? 1 : 0;
+
+  TileMessage tile;
+  while (Receive(&socket, &tile)) {
+    if (tile.width == 0 || tile.height == 0 || tile.x >= scene.width ||
+        tile.y >= scene.height || tile.width > scene.width - tile.x ||
+        tile.height > scene.height - tile.y) {
+      throw std::runtime_error("tile outside the frame");
+    }
+
+    // Anti-aliasing finds edges against neighbouring pixels, so the tile is
+    // rendered with a one-pixel apron of its neighbours, then cut out.
+    const uint32_t x0 = tile.x - std::min(tile.x, apron);
+    const uint32_t y0 = tile.y - std::min(tile.y, apron);
+    const uint32_t x1 = std::min(tile.x + tile.width + apron, scene.width);
+    const uint32_t y1 = std::min(tile.y + tile.height + apron, scene.height);
+    renderer.Resize(x1 - x0, y1 - y0);
+    renderer.SetCrop(scene.width, scene.height, x0, y0);
+    renderer.RenderFrame(scene.settings);
+
+    PixelsMessage pixels{tile.id, {}};
+    pixels.pixels.reserve(size_t{tile.width} * tile.height);
+    const auto& buffer = renderer.buffer();
+    for (uint32_t y = tile.y; y < tile.y + tile.height; ++y) {
+      const auto row = buffer.begin() + (y - y0) * (x1 - x0) + (tile.x - x0);
+      pixels.pixels.insert(pixels.pixels.end(), row, row + tile.width);
+    }
+    try {
+      Send(&socket, pixels);
+    } catch (const std::runtime_error&) {
+      // The coordinator hangs up once the frame is done, which may be while
+      // this worker rendered a copy of a tile another one delivered.
+      return;
+    }
+  }
+}
+
+}  // namespace farm
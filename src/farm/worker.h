@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace farm {
+
+struct WorkerOptions {
+  // Address of the coordinator.
+  std::string host;
+  uint16_t port = 0;
+  // Render threads, overriding what the coordinator asks for.
+  std::optional<uint32_t> threads;
+  // How long to keep retrying to connect, for workers started before the
+  // coordinator.
+  double connect_timeout_s = 10.0;
+};
+
+// Connects to a Coordinator and renders the tiles it hands out with a
+// CPURenderer cropped to each tile, until the coordinator closes the
+// connection, which ends the frame. Throws on malformed requests and when
+// it cannot connect.
+void RunWorker(const WorkerOptions& options);
+
+}  // namespace farm
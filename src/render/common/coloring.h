@@ -21,85 +21,9 @@ MAYBE_DEVICE inline Color ColorFromIter(
   return Color{r, g, b, 255};
 }
 
-MAYBE_DEVICE inline float MandelbulbOrbit(Vector3d pos,
-                                          const FractalSettings& s) {
-  Vector3d z = pos;
-  float dr = 1.0f;
-  float r = 0.0f;
-
-  float orbit = 1e20f;
-
-  for (int i = 0; i < s.max_iterations; i++) {
-    r = Length(z);
-    if (r > s.mandelbulb.boilout) break;
-
-    orbit = fminf(orbit, Length(z));
-    float theta = acosf(z.z / r);
-    float phi = atan2f(z.y, z.x);
-    dr = powf(r, s.mandelbulb.power - 1.0f) * s.mandelbulb.power * dr + 1.0f;
-
-    float zr = powf(r, s.mandelbulb.power);
-    theta *= s.mandelbulb.power;
-    phi *= s.mandelbulb.power;
-
-    z = Vector3d(sinf(theta) * cosf(phi), sinf(phi) * sinf(theta),
-                 cosf(theta)) *
-        zr;
-
-    z = z + pos;
-  }
-
-  float dist = 0.5f * logf(r) * r / dr;
-
-  return orbit;
-}
-
-MAYBE_DEVICE inline float JuliabulbOrbit(const Vector3d& p,
-                                         const FractalSettings& settings) {
-  const float bailout = 2.0f;
-
-  float orbit = 1e20f;
-
-  Vector3d z = p;
-  float dr = 1.0f;
-  float r = 0.0f;
-  for (int i = 0; i < settings.max_iterations; ++i) {
-    r = Length(z);
-    if (r > bailout) break;
-
-    orbit = fminf(orbit, r);
-
-    float r_pow = powf(r, settings.juliabulb.power - 1.0f);
-    dr = r_pow * settings.juliabulb.power * dr + 1.0f;
-
-    float theta = acosf(fmin(fmax(z.z / r, -1.0f), 1.0f));
-    float phi = atan2f(z.y, z.x);
-
-    theta *= settings.juliabulb.power;
-    phi *= settings.juliabulb.power;
-
-    const float sin_theta = sinf(theta);
-    const float cos_theta = cosf(theta);
-    const float cos_phi = cosf(phi);
-    const float sin_phi = sinf(phi);
-    r_pow *= r;
-    z = Vector3d{r_pow * sin_theta * cos_phi, r_pow * cos_theta,
-                 r_pow * sin_theta * sin_phi};
-
-    z = z + settings.juliabulb.c;
-  }
-
-  return orbit;
-}
-
-MAYBE_DEVICE inline Color GetOrbitTrapColor(const Vector3d& pos,
-                                            const FractalSettings& settings) {
-  float orbit;
-  if (settings.type == FractalType::kMandelbulb) {
-    orbit = MandelbulbOrbit(pos, settings);
-  } else if (settings.type == FractalType::kJuliabulb) {
-    orbit = JuliabulbOrbit(pos, settings);
-  }
+// Color of a Mandelbulb or Juliabulb point whose orbit trap, as their SDFs
+// compute it, is `orbit`.
+MAYBE_DEVICE inline Color GetOrbitTrapColor(float orbit) {
   orbit = fmaxf(orbit, 1e-6f) * 0.5f;
 
   const float v = -logf(orbit);
@@ -151,13 +75,14 @@ MAYBE_DEVICE inline Color GetMengerSpongeColor(const Vector3d& normal) {
   };
 }
 
+// Color of the hit `pos`, given the orbit trap its SDF evaluation gave.
 MAYBE_DEVICE inline Color GetFractalColor(const Vector3d& pos,
-                                          const Vector3d& normal,
+                                          const Vector3d& normal, float trap,
                                           const FractalSettings& settings) {
   switch (settings.type) {
     case FractalType::kMandelbulb:
     case FractalType::kJuliabulb:
-      return GetOrbitTrapColor(pos, settings);
+      return GetOrbitTrapColor(trap);
     case FractalType::kMandelbox:
       return GetMandelboxColor(pos);
     case FractalType::kMengerSponge:
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "render/common/types.h"
+#include "render/common/utils.h"
+#include "render/settings_provider.h"
+
+namespace render {
+
+// Cone from the camera around `axis` that holds the rays of a pixel block.
+struct Cone {
+  Ray axis;
+  float cos_half_angle;
+  float tan_half_angle;
+};
+
+// Narrowest cone around the block's mean direction that holds the rays
+// MakeRay builds for the pixels of [x0, x1) x [y0, y1). Ray directions are
+// linear in the pixel position, so the corner pixels bound the angle.
+MAYBE_DEVICE inline Cone MakeCone(uint32_t x0, uint32_t y0, uint32_t x1,
+                                  uint32_t y1, uint32_t width, uint32_t height,
+                                  const CameraSettings& cam) {
+  const Ray corners[4] = {
+      MakeRay(x0, y0, width, height, cam),
+      MakeRay(x1 - 1, y0, width, height, cam),
+      MakeRay(x0, y1 - 1, width, height, cam),
+      MakeRay(x1 - 1, y1 - 1, width, height, cam),
+  };
+  const Vector3d axis =
+      Normalize(corners[0].direction + corners[1].direction +
+                corners[2].direction + corners[3].direction);
+
+  float cos_angle = 1.0f;
+  for (const auto& corner : corners) {
+    cos_angle = fminf(cos_angle, Dot(axis, corner.direction));
+  }
+  const float sin_angle = sqrtf(fmaxf(1.0f - cos_angle * cos_angle, 0.0f));
+  return {{cam.position, axis}, cos_angle, sin_angle / cos_angle};
+}
+
+// Sphere-traces a whole cone against fractal `kType`, starting `t` along its
+// axis. Returns the axis distance up to which the cone is known to be empty.
+// Every ray of the cone may start marching at that ray distance, since it
+// reaches no further along the axis.
+//
+// Stops once the empty ball no longer covers the cone's cross section
+// by a margin of its radius, where single rays advance faster. Sets
+// `escaped` when the whole cross section is farther than `max_distance`
+// from the surface, so every ray of the cone escapes there.
+template <FractalType kType>
+MAYBE_DEVICE inline float ConeMarch(const Cone& cone, float t,
+                                    const FractalSettings& fractal,
+                                    int max_steps, float max_distance,
+                                    bool* escaped) {
+  *escaped = false;
+  for (int i = 0; i < max_steps; ++i) {
+    const auto pos = cone.axis.position + cone.axis.direction * t;
+    const float radius = t * cone.tan_half_angle;
+    const float margin = SignedDistance<kType>(pos, fractal) - radius;
+
+    if (margin > max_distance) {
+      *escaped = true;
+      return t;
+    }
+    if (margin < radius) {
+      return t;
+    }
+
+    // A ray at most the half angle off the axis moves at least this far
+    // along the axis before it leaves the empty ball.
+    t += margin * cone.cos_half_angle;
+  }
+  return t;
+}
+
+}  // namespace render
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cmath>
+
+namespace render {
+
+// Unevaluated sum hi + lo of two doubles, good for about 32 significant
+// digits. Built on the error-free TwoSum/TwoProd transforms, so it must not
+// be compiled with value-changing FP flags (-ffast-math). Host-only.
+struct DoubleDouble {
+  double hi = 0.0;
+  double lo = 0.0;
+
+  DoubleDouble() = default;
+  DoubleDouble(double value) : hi(value) {}
+  DoubleDouble(double hi_part, double lo_part) : hi(hi_part), lo(lo_part) {}
+
+  DoubleDouble operator-() const { return {-hi, -lo}; }
+
+  DoubleDouble operator+(const DoubleDouble& other) const {
+    double e;
+    double s = TwoSum(hi, other.hi, &e);
+    double f;
+    const double t = TwoSum(lo, other.lo, &f);
+    e += t;
+    s = QuickTwoSum(s, e, &e);
+    e += f;
+    s = QuickTwoSum(s, e, &e);
+    return {s, e};
+  }
+
+  DoubleDouble operator-(const DoubleDouble& other) const {
+    return *this + -other;
+  }
+
+  DoubleDouble operator*(const DoubleDouble& other) const {
+    double e;
+    const double p = TwoProd(hi, other.hi, &e);
+    e += hi * other.lo + lo * other.hi;
+    const double s = QuickTwoSum(p, e, &e);
+    return {s, e};
+  }
+
+  bool operator<=(const DoubleDouble& other) const {
+    return hi < other.hi || (hi == other.hi && lo <= other.lo);
+  }
+
+  bool operator==(const DoubleDouble& other) const {
+    return hi == other.hi && lo == other.lo;
+  }
+
+ private:
+  static double TwoSum(double a, double b, double* err) {
+    const double s = a + b;
+    const double bb = s - a;
+    *err = (a - (s - bb)) + (b - bb);
+    return s;
+  }
+
+  // Requires |a| >= |b|.
+  static double QuickTwoSum(double a, double b, double* err) {
+    const double s = a + b;
+    *err = b - (s - a);
+    return s;
+  }
+
+  static double TwoProd(double a, double b, double* err) {
+    const double p = a * b;
+#ifdef FP_FAST_FMA
+    *err = std::fma(a, b, -p);
+#else
+    // Dekker's product: split both factors into 26-bit halves.
+    double a_hi;
+    double a_lo;
+    double b_hi;
+    double b_lo;
+    Split(a, &a_hi, &a_lo);
+    Split(b, &b_hi, &b_lo);
+    *err = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+#endif
+    return p;
+  }
+
+  static void Split(double a, double* hi_part, double* lo_part) {
+    const double t = 134217729.0 * a;  // 2^27 + 1
+    *hi_part = t - (t - a);
+    *lo_part = a - *hi_part;
+  }
+};
+
+}  // namespace render
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "render/common/types.h"
+
+namespace render {
+
+// A value with its gradient with respect to a point in space. Arithmetic on
+// Duals carries the gradient along (forward-mode automatic differentiation),
+// so one evaluation of a function written on Duals yields both.
+// Dual{v, {}} is the constant v.
+struct Dual {
+  float value;
+  Vector3d grad;
+};
+
+// The coordinates of `p`, each with its unit gradient.
+MAYBE_DEVICE inline void DualCoordinates(const Vector3d& p, Dual* x, Dual* y,
+                                         Dual* z) {
+  *x = {p.x, {1.0f, 0.0f, 0.0f}};
+  *y = {p.y, {0.0f, 1.0f, 0.0f}};
+  *z = {p.z, {0.0f, 0.0f, 1.0f}};
+}
+
+MAYBE_DEVICE inline Dual operator+(const Dual& a, const Dual& b) {
+  return {a.value + b.value, a.grad + b.grad};
+}
+
+MAYBE_DEVICE inline Dual operator+(const Dual& a, float b) {
+  return {a.value + b, a.grad};
+}
+
+MAYBE_DEVICE inline Dual operator-(const Dual& a, const Dual& b) {
+  return {a.value - b.value, a.grad - b.grad};
+}
+
+MAYBE_DEVICE inline Dual operator-(const Dual& a) {
+  return {-a.value, -a.grad};
+}
+
+MAYBE_DEVICE inline Dual operator*(const Dual& a, const Dual& b) {
+  return {a.value * b.value, a.grad * b.value + b.grad * a.value};
+}
+
+MAYBE_DEVICE inline Dual operator*(const Dual& a, float b) {
+  return {a.value * b, a.grad * b};
+}
+
+MAYBE_DEVICE inline Dual operator*(float a, const Dual& b) { return b * a; }
+
+MAYBE_DEVICE inline Dual operator/(const Dual& a, const Dual& b) {
+  return {a.value / b.value,
+          (a.grad * b.value - b.grad * a.value) / (b.value * b.value)};
+}
+
+// The gradient of sqrt is infinite at 0; it is taken as 0 there, which is
+// what the points on an axis of symmetry need.
+MAYBE_DEVICE inline Dual Sqrt(const Dual& a) {
+  const float root = sqrtf(a.value);
+  return {root, root > 0.0f ? a.grad * (0.5f / root)
+                            : Vector3d{0.0f, 0.0f, 0.0f}};
+}
+
+MAYBE_DEVICE inline Dual Log(const Dual& a) {
+  return {logf(a.value), a.grad / a.value};
+}
+
+MAYBE_DEVICE inline Dual Pow(const Dual& a, float exponent) {
+  const float power = powf(a.value, exponent - 1.0f);
+  return {power * a.value, a.grad * (exponent * power)};
+}
+
+MAYBE_DEVICE inline Dual Sin(const Dual& a) {
+  return {sinf(a.value), a.grad * cosf(a.value)};
+}
+
+MAYBE_DEVICE inline Dual Cos(const Dual& a) {
+  return {cosf(a.value), a.grad * -sinf(a.value)};
+}
+
+// `a` clamped to [-1, 1], as acos needs; the gradient is 0 where clamped.
+MAYBE_DEVICE inline Dual Acos(const Dual& a) {
+  if (!(a.value > -1.0f && a.value < 1.0f)) {
+    return {acosf(fminf(fmaxf(a.value, -1.0f), 1.0f)), {0.0f, 0.0f, 0.0f}};
+  }
+  return {acosf(a.value), a.grad * (-1.0f / sqrtf(1.0f - a.value * a.value))};
+}
+
+MAYBE_DEVICE inline Dual Atan2(const Dual& y, const Dual& x) {
+  const float length2 = x.value * x.value + y.value * y.value;
+  if (length2 == 0.0f) {
+    return {0.0f, {0.0f, 0.0f, 0.0f}};
+  }
+  return {atan2f(y.value, x.value),
+          (y.grad * x.value - x.grad * y.value) / length2};
+}
+
+}  // namespace render
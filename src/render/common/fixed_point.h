@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace render {
+
+// Signed fixed-point number with one 32-bit integer limb and kFracLimbs
+// 32-bit fraction limbs (about 125 decimal digits). Used for deep-zoom
+// coordinates that neither float nor double can hold. Host-only; the struct
+// stays trivially copyable so it can travel inside RenderSettings.
+struct FixedPoint {
+  static constexpr int kLimbs = 14;
+  static constexpr int kFracLimbs = kLimbs - 1;
+
+  // Little-endian magnitude: limbs[kLimbs - 1] is the integer part.
+  uint32_t limbs[kLimbs] = {};
+  bool negative = false;
+
+  static constexpr FixedPoint FromInt(int32_t value) {
+    FixedPoint result;
+    result.negative = value < 0;
+    result.limbs[kLimbs - 1] = static_cast<uint32_t>(
+        value < 0 ? -static_cast<int64_t>(value) : value);
+    return result;
+  }
+
+  static FixedPoint FromDouble(double value) {
+    FixedPoint result;
+    result.negative = value < 0.0;
+    value = std::fabs(value);
+
+    if (value >= 4294967296.0) {
+      throw std::out_of_range("FixedPoint: value out of range");
+    }
+    for (int i = kLimbs - 1; i >= 0 && value > 0.0; --i) {
+      const double limb = std::floor(value);
+      result.limbs[i] = static_cast<uint32_t>(limb);
+      value = (value - limb) * 4294967296.0;
+    }
+    return result;
+  }
+
+  // Parses a plain decimal such as "-0.7436438870371587047521915".
+  static FixedPoint FromString(const std::string& text) {
+    FixedPoint result;
+    size_t pos = 0;
+    if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+      result.negative = text[pos] == '-';
+      ++pos;
+    }
+
+    const size_t dot = text.find('.', pos);
+    const size_t int_end = dot == std::string::npos ? text.size() : dot;
+    if (int_end == pos && dot == std::string::npos) {
+      throw std::invalid_argument("FixedPoint: empty number");
+    }
+
+    uint64_t int_part = 0;
+    for (size_t i = pos; i < int_end; ++i) {
+      int_part = int_part * 10 + Digit(text[i]);
+      if (int_part >= 4294967296ull) {
+        throw std::out_of_range("FixedPoint: value out of range");
+      }
+    }
+
+    // Horner's scheme from the last digit: frac = (digit + frac) / 10.
+    if (dot != std::string::npos) {
+      for (size_t i = text.size(); i > dot + 1; --i) {
+        result.limbs[kLimbs - 1] = Digit(text[i - 1]);
+        result.DivideMagnitude(10);
+      }
+    }
+    result.limbs[kLimbs - 1] = static_cast<uint32_t>(int_part);
+    return result;
+  }
+
+  double ToDouble() const {
+    double value = 0.0;
+    double weight = 1.0;
+    for (int i = kLimbs - 1; i >= 0 && weight > 0.0; --i) {
+      value += limbs[i] * weight;
+      weight /= 4294967296.0;
+    }
+    return negative ? -value : value;
+  }
+
+  bool IsZero() const {
+    for (uint32_t limb : limbs) {
+      if (limb != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  FixedPoint operator-() const {
+    FixedPoint result = *this;
+    result.negative = !negative && !IsZero();
+    return result;
+  }
+
+  FixedPoint operator+(const FixedPoint& other) const {
+    if (negative == other.negative) {
+      FixedPoint result = AddMagnitudes(*this, other);
+      result.negative = negative;
+      return result;
+    }
+
+    // Different signs: subtract the smaller magnitude from the larger one.
+    const bool this_larger = CompareMagnitudes(*this, other) >= 0;
+    const FixedPoint& larger = this_larger ? *this : other;
+    const FixedPoint& smaller = this_larger ? other : *this;
+    FixedPoint result = SubtractMagnitudes(larger, smaller);
+    result.negative = larger.negative && !result.IsZero();
+    return result;
+  }
+
+  FixedPoint operator-(const FixedPoint& other) const { return *this + -other; }
+
+  FixedPoint operator*(const FixedPoint& other) const {
+    uint32_t product[2 * kLimbs] = {};
+    for (int i = 0; i < kLimbs; ++i) {
+      uint64_t carry = 0;
+      for (int j = 0; j < kLimbs; ++j) {
+        const uint64_t t = product[i + j] +
+                           static_cast<uint64_t>(limbs[i]) * other.limbs[j] +
+                           carry;
+        product[i + j] = static_cast<uint32_t>(t);
+        carry = t >> 32;
+      }
+      product[i + kLimbs] = static_cast<uint32_t>(carry);
+    }
+
+    // Both factors carry kFracLimbs fraction limbs, so drop that many.
+    FixedPoint result;
+    for (int k = 0; k < kLimbs; ++k) {
+      result.limbs[k] = product[k + kFracLimbs];
+    }
+    result.negative = (negative != other.negative) && !result.IsZero();
+    return result;
+  }
+
+  FixedPoint& operator+=(const FixedPoint& other) {
+    return *this = *this + other;
+  }
+
+ private:
+  static uint32_t Digit(char c) {
+    if (c < '0' || c > '9') {
+      throw std::invalid_argument("FixedPoint: bad digit in number");
+    }
+    return static_cast<uint32_t>(c - '0');
+  }
+
+  void DivideMagnitude(uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (int i = kLimbs - 1; i >= 0; --i) {
+      const uint64_t current = (remainder << 32) | limbs[i];
+      limbs[i] = static_cast<uint32_t>(current / divisor);
+      remainder = current % divisor;
+    }
+  }
+
+  static int CompareMagnitudes(const FixedPoint& a, const FixedPoint& b) {
+    for (int i = kLimbs - 1; i >= 0; --i) {
+      if (a.limbs[i] != b.limbs[i]) {
+        return a.limbs[i] < b.limbs[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  static FixedPoint AddMagnitudes(const FixedPoint& a, const FixedPoint& b) {
+    FixedPoint result;
+    uint64_t carry = 0;
+    for (int i = 0; i < kLimbs; ++i) {
+      const uint64_t t = static_cast<uint64_t>(a.limbs[i]) + b.limbs[i] + carry;
+      result.limbs[i] = static_cast<uint32_t>(t);
+      carry = t >> 32;
+    }
+    return result;
+  }
+
+  // Requires |a| >= |b|.
+  static FixedPoint SubtractMagnitudes(const FixedPoint& a,
+                                       const FixedPoint& b) {
+    FixedPoint result;
+    int64_t borrow = 0;
+    for (int i = 0; i < kLimbs; ++i) {
+      int64_t t = static_cast<int64_t>(a.limbs[i]) - b.limbs[i] - borrow;
+      borrow = t < 0 ? 1 : 0;
+      if (t < 0) {
+        t += 4294967296ll;
+      }
+      result.limbs[i] = static_cast<uint32_t>(t);
+    }
+    return result;
+  }
+};
+
+}  // namespace render
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 
+#include "render/common/dual.h"
 #include "render/common/types.h"
 #include "render/settings_provider.h"
 
@@ -17,32 +18,62 @@ MAYBE_DEVICE inline bool Is2DFractal(FractalType type) {
   }
 }
 
-MAYBE_DEVICE inline int MandelbrotIterations(float x, float y, int max_iter) {
-  float zr = 0.0f;
-  float zi = 0.0f;
+// Escape-time iterations are templated on the scalar type: float, double
+// and DoubleDouble cover progressively deeper 2D zooms.
+//
+// Iterates z = z^2 + c from `z` while |z| <= 2, at most `max_iter` times,
+// and returns the iteration count. The orbit is compared with a value saved
+// at every power-of-two iteration (Brent's cycle detection). An orbit that
+// returns to that value exactly is periodic and never escapes, so it ends
+// early with `max_iter`, as the full loop would.
+template <typename T>
+MAYBE_DEVICE inline int OrbitIterations(T zr, T zi, T cr, T ci, int max_iter) {
+  T saved_r = zr;
+  T saved_i = zi;
+  int next_save = 1;
   int i = 0;
 
-  while (zr * zr + zi * zi <= 4.0 && i < max_iter) {
-    float tmp = zr * zr - zi * zi + x;
-    zi = 2.0f * zr * zi + y;
+  while (zr * zr + zi * zi <= T(4) && i < max_iter) {
+    T tmp = zr * zr - zi * zi + cr;
+    zi = T(2) * zr * zi + ci;
     zr = tmp;
     ++i;
+
+    if (zr == saved_r && zi == saved_i) {
+      return max_iter;
+    }
+    if (i == next_save) {
+      saved_r = zr;
+      saved_i = zi;
+      next_save *= 2;
+    }
   }
   return i;
 }
 
-MAYBE_DEVICE inline int JuliaIterations(float x, float y, int max_iter,
-                                        float c_re = -0.8, float c_im = 0.156) {
-  int i = 0;
-
-  while (x * x + y * y <= 4.0 && i < max_iter) {
-    const float x_new = x * x - y * y + c_re;
-    y = 2.0f * x * y + c_im;
-    x = x_new;
+// Whether c lies in the main cardioid or the period-2 bulb of the Mandelbrot
+// set, which hold most of its interior.
+template <typename T>
+MAYBE_DEVICE inline bool InMandelbrotBulbs(T x, T y) {
+  const T xq = x - T(0.25);
+  const T y2 = y * y;
+  const T q = xq * xq + y2;
+  const T xb = x + T(1);
+  return q * (q + xq) <= T(0.25) * y2 || xb * xb + y2 <= T(0.0625);
+}
 
-    ++i;
+template <typename T>
+MAYBE_DEVICE inline int MandelbrotIterations(T x, T y, int max_iter) {
+  if (InMandelbrotBulbs(x, y)) {
+    return max_iter;
   }
-  return i;
+  return OrbitIterations(T(0), T(0), x, y, max_iter);
+}
+
+template <typename T>
+MAYBE_DEVICE inline int JuliaIterations(T x, T y, int max_iter,
+                                        T c_re = T(-0.8), T c_im = T(0.156)) {
+  return OrbitIterations(x, y, c_re, c_im, max_iter);
 }
 
 MAYBE_DEVICE inline float BoxSDF(const Vector3d& p, const Vector3d& b) {
@@ -74,18 +105,90 @@ MAYBE_DEVICE inline float MengerSpongeSDF(Vector3d pos, int iterations) {
   return d;
 }
 
-MAYBE_DEVICE inline float MandelbulbSDF(const Vector3d& pos, int iterations,
-                                        float power = 8.0,
-                                        float bailout = 2.0f) {
+// Whole Mandelbulb powers up to this one take the trig-free path.
+constexpr int kMaxMandelbulbIntegerPower = 16;
+
+// `power` as an int if it is whole and in [2, kMaxMandelbulbIntegerPower],
+// otherwise 0.
+MAYBE_DEVICE inline int MandelbulbIntegerPower(float power) {
+  const int n = static_cast<int>(power);
+  return n == power && n >= 2 && n <= kMaxMandelbulbIntegerPower ? n : 0;
+}
+
+// (re + i im)^n by repeated squaring, for T float or Dual. T{} is zero for
+// both, and constants are built from it.
+template <typename T>
+MAYBE_DEVICE inline void ComplexPower(T* re, T* im, int n) {
+  T base_re = *re;
+  T base_im = *im;
+  T result_re = T{} + 1.0f;
+  T result_im{};
+  while (true) {
+    if (n & 1) {
+      const T t = result_re * base_re - result_im * base_im;
+      result_im = result_re * base_im + result_im * base_re;
+      result_re = t;
+    }
+    n >>= 1;
+    if (n == 0) {
+      break;
+    }
+    const T t = base_re * base_re - base_im * base_im;
+    base_im = 2.0f * base_re * base_im;
+    base_re = t;
+  }
+  *re = result_re;
+  *im = result_im;
+}
+
+template <typename T>
+MAYBE_DEVICE inline T IntegerPow(T x, int n) {
+  T result = T{} + 1.0f;
+  for (; n > 0; n >>= 1) {
+    if (n & 1) {
+      result = result * x;
+    }
+    x = x * x;
+  }
+  return result;
+}
+
+// The Mandelbulb's triplex power: `z`, of length `r`, with its polar angle
+// theta from the z axis and its azimuth phi multiplied by `n` and its length
+// raised to `n`. For whole `n` no trig is needed: cos(theta) + i sin(theta)
+// is (z + i rho) / r and cos(phi) + i sin(phi) is (x + i y) / rho, where rho
+// is the length of (x, y), and multiplying the angles by n raises those to
+// the n-th power.
+MAYBE_DEVICE inline Vector3d TriplexPower(const Vector3d& z, float r, int n) {
+  const float rho = sqrtf(z.x * z.x + z.y * z.y);
+  // At rho == 0 the azimuth is atan2(0, 0) == 0.
+  float phi_re = rho > 0.0f ? z.x / rho : 1.0f;
+  float phi_im = rho > 0.0f ? z.y / rho : 0.0f;
+  float theta_re = z.z / r;
+  float theta_im = rho / r;
+  ComplexPower(&phi_re, &phi_im, n);
+  ComplexPower(&theta_re, &theta_im, n);
+
+  const float zr = IntegerPow(r, n);
+  return {zr * theta_im * phi_re, zr * theta_im * phi_im, zr * theta_re};
+}
+
+// MandelbulbSDF for any `power`, through spherical coordinates.
+MAYBE_DEVICE inline float MandelbulbSDFAnyPower(const Vector3d& pos,
+                                                int iterations, float power,
+                                                float bailout,
+                                                float* trap = nullptr) {
   Vector3d z = pos;
   float dr = 1.0f;
-  float r;
+  float r = Length(z);
+  float orbit = 1e20f;
 
   for (int i = 0; i < iterations; ++i) {
     r = Length(z);
     if (r > bailout) {
       break;
     }
+    orbit = fminf(orbit, r);
 
     float theta = acos(z.z / r);
     float phi = atan2(z.y, z.x);
@@ -102,9 +205,117 @@ MAYBE_DEVICE inline float MandelbulbSDF(const Vector3d& pos, int iterations,
     z = z + pos;
   }
 
+  if (trap) {
+    *trap = orbit;
+  }
   return 0.5 * log(r) * r / dr;
 }
 
+// MandelbulbSDF for whole powers of at least 2, without trig.
+MAYBE_DEVICE inline float MandelbulbSDFIntegerPower(const Vector3d& pos,
+                                                    int iterations, int power,
+                                                    float bailout,
+                                                    float* trap = nullptr) {
+  Vector3d z = pos;
+  float dr = 1.0f;
+  float r = Length(z);
+  float orbit = 1e20f;
+
+  for (int i = 0; i < iterations; ++i) {
+    r = Length(z);
+    if (r > bailout) {
+      break;
+    }
+    orbit = fminf(orbit, r);
+
+    dr = IntegerPow(r, power - 1) * power * dr + 1.0f;
+    z = TriplexPower(z, r, power) + pos;
+  }
+
+  if (trap) {
+    *trap = orbit;
+  }
+  return 0.5f * logf(r) * r / dr;
+}
+
+// If `trap` is set it receives the orbit trap the surface is colored by: the
+// smallest |z| of the iterates within the bailout. It comes out of the same
+// iteration, so a hit's color costs no second pass.
+MAYBE_DEVICE inline float MandelbulbSDF(const Vector3d& pos, int iterations,
+                                        float power = 8.0,
+                                        float bailout = 2.0f,
+                                        float* trap = nullptr) {
+  // The default power 8 takes the trig-free path like any whole power; a
+  // copy with the power a constant measured no faster.
+  if (const int n = MandelbulbIntegerPower(power)) {
+    return MandelbulbSDFIntegerPower(pos, iterations, n, bailout, trap);
+  }
+  return MandelbulbSDFAnyPower(pos, iterations, power, bailout, trap);
+}
+
+// MandelbulbSDF with its gradient. `*reliable` is cleared where the gradient
+// may not describe the SDF a step of `eps` away: where the orbit does not
+// escape, and where it passes within `eps` of the z axis, around which phi
+// turns arbitrarily fast.
+MAYBE_DEVICE inline Dual MandelbulbDualSDF(const Vector3d& pos, int iterations,
+                                           float power, float bailout,
+                                           float eps, bool* reliable) {
+  const int integer_power = MandelbulbIntegerPower(power);
+  Dual cx;
+  Dual cy;
+  Dual cz;
+  DualCoordinates(pos, &cx, &cy, &cz);
+  Dual x = cx;
+  Dual y = cy;
+  Dual z = cz;
+  Dual dr{1.0f, {}};
+  Dual r{0.0f, {}};
+  bool near_axis = false;
+  *reliable = false;
+
+  for (int i = 0; i < iterations; ++i) {
+    r = Sqrt(x * x + y * y + z * z);
+    if (r.value > bailout) {
+      *reliable = !near_axis;
+      break;
+    }
+    const Dual rho = Sqrt(x * x + y * y);
+    near_axis = near_axis || rho.value < eps * Length(rho.grad);
+
+    Dual zr{0.0f, {}};
+    Dual sin_theta{0.0f, {}};
+    Dual cos_theta{0.0f, {}};
+    Dual cos_phi{0.0f, {}};
+    Dual sin_phi{0.0f, {}};
+    if (integer_power) {
+      // As in TriplexPower.
+      cos_phi = rho.value > 0.0f ? x / rho : Dual{1.0f, {}};
+      sin_phi = rho.value > 0.0f ? y / rho : Dual{0.0f, {}};
+      cos_theta = z / r;
+      sin_theta = rho / r;
+      ComplexPower(&cos_phi, &sin_phi, integer_power);
+      ComplexPower(&cos_theta, &sin_theta, integer_power);
+      zr = IntegerPow(r, integer_power - 1);
+    } else {
+      const Dual theta = Acos(z / r) * power;
+      const Dual phi = Atan2(y, x) * power;
+      cos_phi = Cos(phi);
+      sin_phi = Sin(phi);
+      cos_theta = Cos(theta);
+      sin_theta = Sin(theta);
+      zr = Pow(r, power - 1.0f);
+    }
+    dr = zr * power * dr + 1.0f;
+    zr = zr * r;
+
+    x = zr * sin_theta * cos_phi + cx;
+    y = zr * sin_theta * sin_phi + cy;
+    z = zr * cos_theta + cz;
+  }
+
+  return 0.5f * Log(r) * r / dr;
+}
+
 MAYBE_DEVICE inline float MandelboxSDF(const Vector3d& pos, int iterations,
                                        float min_radius, float fixed_radius,
                                        float scale) {
@@ -143,17 +354,21 @@ MAYBE_DEVICE inline float MandelboxSDF(const Vector3d& pos, int iterations,
   return Length(z) / dr;
 }
 
+// `trap` as with MandelbulbSDF.
 MAYBE_DEVICE inline float JuliabulbSDF(const Vector3d& p, int max_iter,
                                        const Vector3d& c = {0.1, 1.0, 0.0},
-                                       float power = 5.5) {
+                                       float power = 5.5,
+                                       float* trap = nullptr) {
   const float bailout = 2.0f;
 
   Vector3d z = p;
   float dr = 1.0f;
   float r = 0.0f;
+  float orbit = 1e20f;
   for (int i = 0; i < max_iter; ++i) {
     r = Length(z);
     if (r > bailout) break;
+    orbit = fminf(orbit, r);
 
     float r_pow = powf(r, power - 1.0f);
     dr = r_pow * power * dr + 1.0f;
@@ -175,7 +390,49 @@ MAYBE_DEVICE inline float JuliabulbSDF(const Vector3d& p, int max_iter,
     z = z + c;
   }
 
+  if (trap) {
+    *trap = orbit;
+  }
   return 0.5f * logf(r) * r / dr;
 }
 
+// JuliabulbSDF with its gradient, and `*reliable` as with MandelbulbDualSDF.
+MAYBE_DEVICE inline Dual JuliabulbDualSDF(const Vector3d& p, int max_iter,
+                                          const Vector3d& c, float power,
+                                          float eps, bool* reliable) {
+  const float bailout = 2.0f;
+
+  Dual x;
+  Dual y;
+  Dual z;
+  DualCoordinates(p, &x, &y, &z);
+  Dual dr{1.0f, {}};
+  Dual r{0.0f, {}};
+  bool near_axis = false;
+  *reliable = false;
+  for (int i = 0; i < max_iter; ++i) {
+    r = Sqrt(x * x + y * y + z * z);
+    if (r.value > bailout) {
+      *reliable = !near_axis;
+      break;
+    }
+    const Dual rho = Sqrt(x * x + y * y);
+    near_axis = near_axis || rho.value < eps * Length(rho.grad);
+
+    Dual r_pow = Pow(r, power - 1.0f);
+    dr = r_pow * power * dr + 1.0f;
+
+    const Dual theta = Acos(z / r) * power;
+    const Dual phi = Atan2(y, x) * power;
+
+    const Dual sin_theta = Sin(theta);
+    r_pow = r_pow * r;
+    x = r_pow * sin_theta * Cos(phi) + c.x;
+    y = r_pow * Cos(theta) + c.y;
+    z = r_pow * sin_theta * Sin(phi) + c.z;
+  }
+
+  return 0.5f * Log(r) * r / dr;
+}
+
 }  // namespace render
@@ -1,29 +1,55 @@
 #pragma once
 
+#include <type_traits>
+
 #include "render/common/fractals.h"
 #include "render/common/types.h"
 #include "render/settings_provider.h"
 
 namespace render {
 
-MAYBE_DEVICE inline Vector3d PixelToPosition(int x, int y, uint32_t width,
-                                             uint32_t height,
-                                             const CameraSettings& cam) {
-  float u = (static_cast<float>(x) + 0.5) / width * 2.0f - 1.0f;
-  float v = (static_cast<float>(y) + 0.5) / height * 2.0f - 1.0f;
+// Center, half-height and aspect of the 2D plane in scalar type T.
+template <typename T>
+struct PlaneView {
+  T center_x;
+  T center_y;
+  T scale;
+  T aspect;
+};
 
-  u *= cam.aspect;
+// The point of the plane at (sx, sy) within pixel (x, y), whose square
+// spans [0, 1)^2; the pixel center by default.
+template <typename T>
+MAYBE_DEVICE inline void PixelToPosition(int x, int y, uint32_t width,
+                                         uint32_t height,
+                                         const PlaneView<T>& view, T* re,
+                                         T* im, double sx = 0.5,
+                                         double sy = 0.5) {
+  const T u = T((x + sx) / width * 2.0 - 1.0) * view.aspect;
+  const T v = T((y + sy) / height * 2.0 - 1.0);
 
-  Vector3d p = cam.position + Vector3d{1.0f, 0.0f, 0.0f} * (u * cam.scale) +
-               Vector3d{0.0f, 1.0f, 0.0f} * (v * cam.scale);
+  *re = view.center_x + u * view.scale;
+  *im = view.center_y + v * view.scale;
+}
 
-  return {p.x, p.y};
+MAYBE_DEVICE inline Vector3d PixelToPosition(int x, int y, uint32_t width,
+                                             uint32_t height,
+                                             const CameraSettings& cam) {
+  const PlaneView<float> view{cam.position.x, cam.position.y, cam.scale,
+                              cam.aspect};
+  float re;
+  float im;
+  PixelToPosition(x, y, width, height, view, &re, &im);
+  return {re, im, cam.position.z};
 }
 
+// The camera ray through (sx, sy) within pixel (x, y), like
+// PixelToPosition.
 MAYBE_DEVICE inline Ray MakeRay(int x, int y, uint32_t width, uint32_t height,
-                                const CameraSettings& cam) {
-  float u = (x + 0.5) / width * 2.0f - 1.0f;
-  float v = -((y + 0.5) / height * 2.0f - 1.0f);
+                                const CameraSettings& cam, double sx = 0.5,
+                                double sy = 0.5) {
+  float u = (x + sx) / width * 2.0f - 1.0f;
+  float v = -((y + sy) / height * 2.0f - 1.0f);
   u *= cam.aspect;
 
   const auto right = Normalize(Cross(cam.direction, {0.0f, 0.0f, 1.0f}));
@@ -34,43 +60,188 @@ MAYBE_DEVICE inline Ray MakeRay(int x, int y, uint32_t width, uint32_t height,
   return {cam.position, dir};
 }
 
+// Inverse of MakeRay: the continuous pixel coordinates `position` projects
+// to, pixel (x, y) covering [x, x + 1) x [y, y + 1). Returns false for points
+// behind the camera.
+MAYBE_DEVICE inline bool PositionToPixel(const Vector3d& position,
+                                         uint32_t width, uint32_t height,
+                                         const CameraSettings& cam, float* x,
+                                         float* y) {
+  const auto right = Normalize(Cross(cam.direction, {0.0f, 0.0f, 1.0f}));
+  const auto up = Normalize(Cross(cam.direction, right));
+
+  const auto offset = position - cam.position;
+  const float depth = Dot(offset, Normalize(cam.direction));
+  if (depth <= 0.0f) {
+    return false;
+  }
+
+  const float u = Dot(offset, right) / depth / cam.aspect;
+  const float v = Dot(offset, up) / depth;
+  *x = (u + 1.0f) * 0.5f * width;
+  *y = (1.0f - v) * 0.5f * height;
+  return true;
+}
+
+// Distance estimate of the 3D fractal `kType`. Marching loops take the type
+// as a template argument so each fractal gets a loop of its own, with its SDF
+// inlined, instead of switching on the type at every step.
+//
+// For the fractals colored by orbit traps, a non-null `trap` receives the
+// trap GetFractalColor takes; see MandelbulbSDF. Others leave it alone.
+template <FractalType kType>
+MAYBE_DEVICE inline float SignedDistance(const Vector3d& position,
+                                         const FractalSettings& fractal,
+                                         float* trap = nullptr) {
+  if constexpr (kType == FractalType::kMengerSponge) {
+    return MengerSpongeSDF(position, fractal.max_iterations);
+  } else if constexpr (kType == FractalType::kMandelbulb) {
+    return MandelbulbSDF(position, fractal.max_iterations,
+                         fractal.mandelbulb.power, fractal.mandelbulb.boilout,
+                         trap);
+  } else if constexpr (kType == FractalType::kMandelbox) {
+    return MandelboxSDF(position, fractal.max_iterations,
+                        fractal.mandelbox.min_radius,
+                        fractal.mandelbox.fixed_radius,
+                        fractal.mandelbox.scale);
+  } else if constexpr (kType == FractalType::kJuliabulb) {
+    return JuliabulbSDF(position, fractal.max_iterations, fractal.juliabulb.c,
+                        fractal.juliabulb.power, trap);
+  } else {
+    return 100.0;
+  }
+}
+
+// How surface normals are estimated from the SDF.
+enum class NormalMethod : uint8_t {
+  // Central differences along the axes: six SDF evaluations.
+  kCentral,
+  // Differences towards the corners of a tetrahedron: four evaluations.
+  kTetrahedral,
+  // The SDF's gradient by forward-mode differentiation, in one evaluation on
+  // Dual numbers. Points where the gradient may not describe the SDF over
+  // the difference step use kCentral, and fractals without a Dual SDF
+  // kTetrahedral.
+  kDual,
+};
+
+template <FractalType kType>
+MAYBE_DEVICE inline Vector3d CentralNormal(const Vector3d& position,
+                                           const FractalSettings& fractal,
+                                           float eps) {
+  float dx =
+      SignedDistance<kType>(position + Vector3d{eps, 0.0f, 0.0f}, fractal) -
+      SignedDistance<kType>(position - Vector3d{eps, 0.0f, 0.0f}, fractal);
+  float dy =
+      SignedDistance<kType>(position + Vector3d{0.0f, eps, 0.0f}, fractal) -
+      SignedDistance<kType>(position - Vector3d{0.0f, eps, 0.0f}, fractal);
+  float dz =
+      SignedDistance<kType>(position + Vector3d{0.0f, 0.0f, eps}, fractal) -
+      SignedDistance<kType>(position - Vector3d{0.0f, 0.0f, eps}, fractal);
+
+  return Normalize(Vector3d{dx, dy, dz} / eps);
+}
+
+// The corners k of a regular tetrahedron sum to zero, so the sum of k * f(p
+// + k * h) cancels f(p) and leaves the gradient, scaled. h puts the samples
+// `eps` from `position`, as far as the central ones.
+template <FractalType kType>
+MAYBE_DEVICE inline Vector3d TetrahedralNormal(const Vector3d& position,
+                                               const FractalSettings& fractal,
+                                               float eps) {
+  const Vector3d corners[4] = {{1.0f, -1.0f, -1.0f},
+                               {-1.0f, -1.0f, 1.0f},
+                               {-1.0f, 1.0f, -1.0f},
+                               {1.0f, 1.0f, 1.0f}};
+  const float h = eps * 0.57735027f;
+  Vector3d sum{0.0f, 0.0f, 0.0f};
+  for (const auto& corner : corners) {
+    sum = sum + corner * SignedDistance<kType>(position + corner * h, fractal);
+  }
+  return Normalize(sum);
+}
+
+template <FractalType kType>
+MAYBE_DEVICE inline Vector3d DualNormal(const Vector3d& position,
+                                        const FractalSettings& fractal,
+                                        float eps) {
+  if constexpr (kType == FractalType::kMandelbulb) {
+    bool reliable = false;
+    const Dual sdf = MandelbulbDualSDF(
+        position, fractal.max_iterations, fractal.mandelbulb.power,
+        fractal.mandelbulb.boilout, eps, &reliable);
+    return reliable ? Normalize(sdf.grad)
+                    : CentralNormal<kType>(position, fractal, eps);
+  } else if constexpr (kType == FractalType::kJuliabulb) {
+    bool reliable = false;
+    const Dual sdf =
+        JuliabulbDualSDF(position, fractal.max_iterations, fractal.juliabulb.c,
+                         fractal.juliabulb.power, eps, &reliable);
+    return reliable ? Normalize(sdf.grad)
+                    : CentralNormal<kType>(position, fractal, eps);
+  } else {
+    return TetrahedralNormal<kType>(position, fractal, eps);
+  }
+}
+
+template <FractalType kType>
+MAYBE_DEVICE inline Vector3d GetNormal(
+    const Vector3d& position, const FractalSettings& fractal,
+    NormalMethod method = NormalMethod::kCentral, float eps = 1e-3) {
+  switch (method) {
+    case NormalMethod::kTetrahedral:
+      return TetrahedralNormal<kType>(position, fractal, eps);
+    case NormalMethod::kDual:
+      return DualNormal<kType>(position, fractal, eps);
+    default:
+      return CentralNormal<kType>(position, fractal, eps);
+  }
+}
+
+// Calls `fn` with std::integral_constant<FractalType, type>, whose value can
+// be passed on as a template argument: switches once per call to `fn` rather
+// than once per SDF evaluation. 2D types have no surface and map to
+// kMandelbrot, for which SignedDistance is a constant.
+template <typename Fn>
+inline decltype(auto) DispatchFractal3D(FractalType type, Fn&& fn) {
+  switch (type) {
+    case FractalType::kMengerSponge:
+      return fn(std::integral_constant<FractalType,
+                                       FractalType::kMengerSponge>{});
+    case FractalType::kMandelbulb:
+      return fn(
+          std::integral_constant<FractalType, FractalType::kMandelbulb>{});
+    case FractalType::kMandelbox:
+      return fn(
+          std::integral_constant<FractalType, FractalType::kMandelbox>{});
+    case FractalType::kJuliabulb:
+      return fn(
+          std::integral_constant<FractalType, FractalType::kJuliabulb>{});
+    default:
+      return fn(
+          std::integral_constant<FractalType, FractalType::kMandelbrot>{});
+  }
+}
+
+// Switches on the type at every call; loops should use SignedDistance.
 MAYBE_DEVICE inline float CalculateSignedDistance(
     const Vector3d& position, const RenderSettings& settings) {
   switch (settings.fractal.type) {
     case FractalType::kMengerSponge:
-      return MengerSpongeSDF(position, settings.fractal.max_iterations);
+      return SignedDistance<FractalType::kMengerSponge>(position,
+                                                        settings.fractal);
     case FractalType::kMandelbulb:
-      return MandelbulbSDF(position, settings.fractal.max_iterations,
-                           settings.fractal.mandelbulb.power,
-                           settings.fractal.mandelbulb.boilout);
+      return SignedDistance<FractalType::kMandelbulb>(position,
+                                                      settings.fractal);
     case FractalType::kMandelbox:
-      return MandelboxSDF(position, settings.fractal.max_iterations,
-                          settings.fractal.mandelbox.min_radius,
-                          settings.fractal.mandelbox.fixed_radius,
-                          settings.fractal.mandelbox.scale);
+      return SignedDistance<FractalType::kMandelbox>(position,
+                                                     settings.fractal);
     case FractalType::kJuliabulb:
-      return JuliabulbSDF(position, settings.fractal.max_iterations,
-                          settings.fractal.juliabulb.c,
-                          settings.fractal.juliabulb.power);
+      return SignedDistance<FractalType::kJuliabulb>(position,
+                                                     settings.fractal);
     default:
       return 100.0;
   }
 }
 
-MAYBE_DEVICE inline Vector3d GetNormal(const Vector3d& position,
-                                       const RenderSettings& settings,
-                                       float eps = 1e-3) {
-  float dx =
-      CalculateSignedDistance(position + Vector3d{eps, 0.0f, 0.0f}, settings) -
-      CalculateSignedDistance(position - Vector3d{eps, 0.0f, 0.0f}, settings);
-  float dy =
-      CalculateSignedDistance(position + Vector3d{0.0f, eps, 0.0f}, settings) -
-      CalculateSignedDistance(position - Vector3d{0.0f, eps, 0.0f}, settings);
-  float dz =
-      CalculateSignedDistance(position + Vector3d{0.0f, 0.0f, eps}, settings) -
-      CalculateSignedDistance(position - Vector3d{0.0f, 0.0f, eps}, settings);
-
-  return Normalize(Vector3d{dx, dy, dz} / eps);
-}
-
 }  // namespace render
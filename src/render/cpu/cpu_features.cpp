@@ -0,0 +1,69 @@
+#include "render/cpu/cpu_features.h"
+
+#if defined(RENDER_X86_SIMD) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace render {
+
+namespace {
+
+#if defined(RENDER_X86_SIMD) && defined(_MSC_VER)
+bool CpuidBit(int leaf, int sub_leaf, int reg, int bit) {
+  int regs[4];
+  __cpuidex(regs, leaf, sub_leaf);
+  return (regs[reg] >> bit) & 1;
+}
+#endif
+
+SimdLevel QuerySimdLevel() {
+#if !defined(RENDER_X86_SIMD)
+  return SimdLevel::kScalar;
+#elif defined(_MSC_VER)
+  // OSXSAVE, then check that the OS saves the YMM/ZMM register state.
+  if (!CpuidBit(1, 0, 2, 27)) {
+    return SimdLevel::kScalar;
+  }
+  const auto xcr0 = _xgetbv(0);
+  const bool avx_state = (xcr0 & 0x6) == 0x6;
+  const bool avx512_state = (xcr0 & 0xe6) == 0xe6;
+
+  if (avx512_state && CpuidBit(7, 0, 1, 16)) {
+    return SimdLevel::kAVX512;
+  }
+  if (avx_state && CpuidBit(7, 0, 1, 5)) {
+    return SimdLevel::kAVX2;
+  }
+  return SimdLevel::kScalar;
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SimdLevel::kAVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::kAVX2;
+  }
+  return SimdLevel::kScalar;
+#endif
+}
+
+}  // namespace
+
+SimdLevel DetectSimdLevel() {
+  static const SimdLevel level = QuerySimdLevel();
+  return level;
+}
+
+const char* SimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::kAVX2:
+      return "avx2";
+    case SimdLevel::kAVX512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+}  // namespace render
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace render {
+
+enum class SimdLevel : uint8_t {
+  kScalar,
+  kAVX2,
+  kAVX512,
+};
+
+// Widest instruction set that both the build and the running CPU support.
+SimdLevel DetectSimdLevel();
+
+const char* SimdLevelName(SimdLevel level);
+
+}  // namespace render
@@ -1,107 +1,1367 @@
 #include "render/cpu/cpu_renderer.h"
 
-#include "QOpenGLFunctions"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
 #include "render/common/coloring.h"
+#include "render/common/cone_march.h"
+#include "render/common/double_double.h"
 #include "render/common/fractals.h"
 #include "render/common/utils.h"
+#include "render/cpu/perturbation.h"
+#include "render/cpu/trace.h"
 
 namespace render {
 
-CPURenderer::CPURenderer() = default;
+namespace {
+
+constexpr MarchLimits kMarchLimits{
+    .max_steps = 100,
+    .hit_epsilon = 0.001f,
+    .max_distance = 2.0f,
+};
+
+constexpr Color kBackgroundColor = {100, 100, 100, 255};
+
+// The cone pre-pass marches one cone per tile, then one per square block of
+// this many pixels, each for at most kConeSteps steps.
+constexpr uint32_t kConeBlock = 8;
+constexpr int kConeSteps = 32;
+
+// Reprojected ray starts are pulled in by this fraction of their depth, so
+// surface detail between the last frame's samples is not stepped over.
+constexpr float kDepthReuseSlack = 0.1f;
+// +inf as float bits, marking pixels no reprojected ray end landed on.
+constexpr uint32_t kNoReprojectedDepth = 0x7f800000u;
+
+// Subdivision stops at rectangles this narrow and iterates their inside.
+constexpr uint32_t kMinSubdivision = 4;
+// Escape counts of tile pixels the subdivision has not iterated yet, and of
+// those queued for the next batch.
+constexpr int kNotIterated = -1;
+constexpr int kPending = -2;
+
+// Deep-zoom pixels still glitched after this many reference orbits keep
+// their last escape count.
+constexpr int kMaxReferences = 32;
+// Glitched pixels are re-iterated in chunks of this many pixels.
+constexpr uint32_t kGlitchChunk = 1024;
+
+// Anti-aliasing takes neighbouring 2D pixels for an edge when one is inside
+// the set and the other not, or when their escape counts differ by more
+// than 1/kEdgeLevels of the iteration limit, which ColorFromIter spreads
+// over the whole color ramp. Neighbouring 3D hits are an edge when their
+// depths differ by more than kEdgeDepth of the nearer one, their normals by
+// more than acos(kEdgeCosine) or a color channel by more than kEdgeContrast.
+constexpr int kEdgeLevels = 32;
+constexpr float kEdgeDepth = 0.05f;
+constexpr float kEdgeCosine = 0.5f;
+constexpr int kEdgeContrast = 48;
+
+// A 2D precision is good enough while its rounding error across the view
+// stays this many times below the pixel spacing.
+constexpr double kPrecisionMargin = 16.0;
+// 2^-104, the combined mantissa of a DoubleDouble.
+constexpr double kDoubleDoubleEpsilon = 4.93e-32;
+
+// A 2D view that moved by within this fraction of a whole number of pixels
+// reuses the pixels of the last frame.
+constexpr double kPanTolerance = 1e-3;
+
+enum class Precision2D { kFloat, kDouble, kDoubleDouble, kPerturbation };
+
+// Cheapest precision that still resolves neighbouring pixels of `view`.
+Precision2D ChoosePrecision(const View2DSettings& view, float aspect,
+                            uint32_t height) {
+  const double spacing = 2.0 * view.scale / height;
+  const double extent = std::max(std::fabs(view.center_x.ToDouble()),
+                                 std::fabs(view.center_y.ToDouble())) +
+                        view.scale * std::max(1.0f, aspect);
+  const double relative = spacing / (extent * kPrecisionMargin);
+
+  if (relative >= FLT_EPSILON) {
+    return Precision2D::kFloat;
+  }
+  if (relative >= DBL_EPSILON) {
+    return Precision2D::kDouble;
+  }
+  if (relative >= kDoubleDoubleEpsilon) {
+    return Precision2D::kDoubleDouble;
+  }
+  return Precision2D::kPerturbation;
+}
+
+// Whole-pixel offset (dx, dy) such that pixel (x, y) of a 2D frame of `to`
+// shows what pixel (x + dx, y + dy) showed for `from`. False when the views
+// differ in more than a translation, or by a fraction of a pixel.
+bool PanOffset(const RenderSettings& from, const RenderSettings& to,
+               uint32_t width, uint32_t height, int32_t* dx, int32_t* dy) {
+  const auto& a = from.fractal;
+  const auto& b = to.fractal;
+  if (a.type != b.type || a.max_iterations != b.max_iterations ||
+      a.julia.c_re != b.julia.c_re || a.julia.c_im != b.julia.c_im ||
+      from.view2d.scale != to.view2d.scale ||
+      from.view2d.deep_zoom != to.view2d.deep_zoom ||
+      from.camera.aspect != to.camera.aspect ||
+      ChoosePrecision(from.view2d, from.camera.aspect, height) !=
+          ChoosePrecision(to.view2d, to.camera.aspect, height)) {
+    return false;
+  }
+
+  // Pixel spacing as PixelToPosition maps pixels.
+  const double spacing_x = 2.0 * to.camera.aspect * to.view2d.scale / width;
+  const double spacing_y = 2.0 * to.view2d.scale / height;
+  const double px =
+      (to.view2d.center_x - from.view2d.center_x).ToDouble() / spacing_x;
+  const double py =
+      (to.view2d.center_y - from.view2d.center_y).ToDouble() / spacing_y;
+  const double rx = std::round(px);
+  const double ry = std::round(py);
+  if (std::fabs(px - rx) > kPanTolerance ||
+      std::fabs(py - ry) > kPanTolerance || std::fabs(rx) >= width ||
+      std::fabs(ry) >= height) {
+    return false;
+  }
+
+  *dx = static_cast<int32_t>(rx);
+  *dy = static_cast<int32_t>(ry);
+  return true;
+}
+
+template <typename T>
+T FromFixedPoint(const FixedPoint& value) {
+  return static_cast<T>(value.ToDouble());
+}
+
+template <>
+DoubleDouble FromFixedPoint<DoubleDouble>(const FixedPoint& value) {
+  const double hi = value.ToDouble();
+  return {hi, (value - FixedPoint::FromDouble(hi)).ToDouble()};
+}
+
+template <typename T>
+PlaneView<T> MakePlaneView(const RenderSettings& settings) {
+  const auto& view = settings.view2d;
+  return {FromFixedPoint<T>(view.center_x), FromFixedPoint<T>(view.center_y),
+          T(view.scale), T(settings.camera.aspect)};
+}
+
+void IteratePoints(const EscapeTimeKernels& kernels,
+                   const FractalSettings& fractal, const float* xs,
+                   const float* ys, uint32_t count, int* out) {
+  const int max_iter = fractal.max_iterations;
+  if (fractal.type == FractalType::kMandelbrot) {
+    kernels.mandelbrot(xs, ys, count, max_iter, out);
+  } else {
+    kernels.julia(xs, ys, count, max_iter, fractal.julia.c_re,
+                  fractal.julia.c_im, out);
+  }
+}
+
+void IteratePoints(const EscapeTimeKernels& kernels,
+                   const FractalSettings& fractal, const double* xs,
+                   const double* ys, uint32_t count, int* out) {
+  const int max_iter = fractal.max_iterations;
+  if (fractal.type == FractalType::kMandelbrot) {
+    kernels.mandelbrot_double(xs, ys, count, max_iter, out);
+  } else {
+    kernels.julia_double(xs, ys, count, max_iter, fractal.julia.c_re,
+                         fractal.julia.c_im, out);
+  }
+}
+
+void IteratePoints(const EscapeTimeKernels&, const FractalSettings& fractal,
+                   const DoubleDouble* xs, const DoubleDouble* ys,
+                   uint32_t count, int* out) {
+  const int max_iter = fractal.max_iterations;
+  const DoubleDouble c_re(fractal.julia.c_re);
+  const DoubleDouble c_im(fractal.julia.c_im);
+  for (uint32_t i = 0; i < count; ++i) {
+    out[i] = fractal.type == FractalType::kMandelbrot
+                 ? MandelbrotIterations(xs[i], ys[i], max_iter)
+                 : JuliaIterations(xs[i], ys[i], max_iter, c_re, c_im);
+  }
+}
+
+// Mariani-Silver on a `width` x `height` tile with escape counts `counts`.
+// Calls `iterate` on batches of pixels that need computing and fills the
+// rest. Rectangles are split a level at a time, so each batch holds the
+// borders of a whole level and fills the SIMD lanes of the kernels.
+template <typename Iterate>
+void SubdivideTile(uint32_t width, uint32_t height, std::vector<int>* counts,
+                   const Iterate& iterate) {
+  struct Rect {
+    uint32_t x0;
+    uint32_t y0;
+    uint32_t x1;
+    uint32_t y1;
+  };
+
+  // Calls `fn` on the border pixels of `rect`, clockwise from the top left
+  // corner.
+  const auto for_each_border = [width](const Rect& rect, const auto& fn) {
+    for (uint32_t x = rect.x0; x < rect.x1; ++x) {
+      fn(rect.y0 * width + x);
+    }
+    for (uint32_t y = rect.y0 + 1; y < rect.y1; ++y) {
+      fn(y * width + rect.x1 - 1);
+    }
+    if (rect.y1 - rect.y0 > 1) {
+      for (uint32_t x = rect.x1 - 1; x-- > rect.x0;) {
+        fn((rect.y1 - 1) * width + x);
+      }
+    }
+    if (rect.x1 - rect.x0 > 1 && rect.y1 - rect.y0 > 2) {
+      for (uint32_t y = rect.y1 - 1; --y > rect.y0;) {
+        fn(y * width + rect.x0);
+      }
+    }
+  };
+
+  std::vector<Rect> level = {{0, 0, width, height}};
+  std::vector<Rect> next;
+  std::vector<uint32_t> pending;
+  // Insides of the smallest rectangles, iterated in one batch at the end.
+  std::vector<uint32_t> interiors;
+
+  while (!level.empty()) {
+    // Neighbouring rectangles share edges, which are iterated only once.
+    pending.clear();
+    for (const Rect& rect : level) {
+      for_each_border(rect, [&](uint32_t pixel) {
+        if ((*counts)[pixel] == kNotIterated) {
+          (*counts)[pixel] = kPending;
+          pending.push_back(pixel);
+        }
+      });
+    }
+    if (!pending.empty()) {
+      iterate(pending);
+    }
+
+    next.clear();
+    for (const Rect& rect : level) {
+      if (rect.x1 - rect.x0 <= 2 || rect.y1 - rect.y0 <= 2) {
+        continue;
+      }
+
+      const int first = (*counts)[rect.y0 * width + rect.x0];
+      bool uniform = true;
+      for_each_border(rect, [&](uint32_t pixel) {
+        uniform = uniform && (*counts)[pixel] == first;
+      });
+
+      if (uniform) {
+        for (uint32_t y = rect.y0 + 1; y + 1 < rect.y1; ++y) {
+          for (uint32_t x = rect.x0 + 1; x + 1 < rect.x1; ++x) {
+            (*counts)[y * width + x] = first;
+          }
+        }
+      } else if (rect.x1 - rect.x0 <= kMinSubdivision ||
+                 rect.y1 - rect.y0 <= kMinSubdivision) {
+        for (uint32_t y = rect.y0 + 1; y + 1 < rect.y1; ++y) {
+          for (uint32_t x = rect.x0 + 1; x + 1 < rect.x1; ++x) {
+            interiors.push_back(y * width + x);
+          }
+        }
+      } else {
+        // Quarters overlap on the middle row and column, so their borders
+        // cover the whole inside.
+        const uint32_t xm = (rect.x0 + rect.x1) / 2;
+        const uint32_t ym = (rect.y0 + rect.y1) / 2;
+        next.push_back({rect.x0, rect.y0, xm + 1, ym + 1});
+        next.push_back({xm, rect.y0, rect.x1, ym + 1});
+        next.push_back({rect.x0, ym, xm + 1, rect.y1});
+        next.push_back({xm, ym, rect.x1, rect.y1});
+      }
+    }
+    level.swap(next);
+  }
+
+  if (!interiors.empty()) {
+    iterate(interiors);
+  }
+}
+
+// SDF evaluations GetNormal<kType> makes with `method`, counting one on Dual
+// numbers as one.
+template <FractalType kType>
+uint32_t NormalEvaluations(NormalMethod method) {
+  constexpr bool kHasDual = kType == FractalType::kMandelbulb ||
+                            kType == FractalType::kJuliabulb;
+  switch (method) {
+    case NormalMethod::kTetrahedral:
+      return 4;
+    case NormalMethod::kDual:
+      return kHasDual ? 1 : 4;
+    default:
+      return 6;
+  }
+}
+
+// kMarchLimits with the relaxation of `settings`.
+MarchLimits MakeMarchLimits(const RenderSettings& settings) {
+  MarchLimits limits = kMarchLimits;
+  limits.relaxation = settings.relaxation;
+  return limits;
+}
+
+// Color of a ray that marched to `result`. Sets `normal` for hits.
+template <FractalType kType>
+Color ShadeRay(const Ray& ray, const MarchResult& result,
+               const FractalSettings& fractal, NormalMethod normals,
+               Vector3d* normal) {
+  switch (result.status) {
+    case MarchStatus::kHit: {
+      const auto pos = ray.position + ray.direction * result.t;
+      *normal = GetNormal<kType>(pos, fractal, normals);
+      return GetFractalColor(pos, *normal, result.trap, fractal);
+    }
+    case MarchStatus::kEscaped:
+      return kBackgroundColor;
+    default:
+      return {0, 0, 0, 255};
+  }
+}
+
+// Appends the pixels in [x0, x1) x [y0, y1) of a `width` x `height` frame
+// for which `differs(pixel, neighbour)` holds with one of their four
+// neighbours, as buffer indices.
+template <typename Differs>
+void AppendEdges(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                 uint32_t width, uint32_t height, const Differs& differs,
+                 std::vector<uint32_t>* edges) {
+  for (uint32_t y = y0; y < y1; ++y) {
+    for (uint32_t x = x0; x < x1; ++x) {
+      const uint32_t pixel = y * width + x;
+      if ((x > 0 && differs(pixel, pixel - 1)) ||
+          (x + 1 < width && differs(pixel, pixel + 1)) ||
+          (y > 0 && differs(pixel, pixel - width)) ||
+          (y + 1 < height && differs(pixel, pixel + width))) {
+        edges->push_back(pixel);
+      }
+    }
+  }
+}
+
+// Position in the pixel square [0, 1)^2 of extra sample `index` of `pixel`:
+// the R2 low-discrepancy sequence, shifted by a hash of the pixel so that
+// neighbouring pixels do not sample one pattern.
+void SampleOffset(uint32_t pixel, uint32_t index, double* sx, double* sy) {
+  // 1/g and 1/g^2 for the plastic number g.
+  constexpr double kR2X = 0.7548776662466927;
+  constexpr double kR2Y = 0.5698402909980532;
+  uint32_t hash = pixel * 0x9e3779b9u;
+  hash = (hash ^ (hash >> 16)) * 0x85ebca6bu;
+  hash ^= hash >> 13;
+  const double shift_x = (hash & 0xffff) / 65536.0;
+  const double shift_y = (hash >> 16) / 65536.0;
+  *sx = std::fmod(shift_x + (index + 1) * kR2X, 1.0);
+  *sy = std::fmod(shift_y + (index + 1) * kR2Y, 1.0);
+}
+
+// Channel sums of a pixel's samples.
+struct ColorSum {
+  uint32_t r = 0;
+  uint32_t g = 0;
+  uint32_t b = 0;
+
+  void Add(Color color) {
+    r += color.r;
+    g += color.g;
+    b += color.b;
+  }
+  Color Average(uint32_t count) const {
+    const uint32_t half = count / 2;
+    return {static_cast<uint8_t>((r + half) / count),
+            static_cast<uint8_t>((g + half) / count),
+            static_cast<uint8_t>((b + half) / count), 255};
+  }
+};
+
+// Whether `a` and `b` describe the same 3D surface, so depths stay valid.
+bool SameSurface(const FractalSettings& a, const FractalSettings& b) {
+  if (a.type != b.type || a.max_iterations != b.max_iterations) {
+    return false;
+  }
+  switch (a.type) {
+    case FractalType::kMandelbulb:
+      return a.mandelbulb.power == b.mandelbulb.power &&
+             a.mandelbulb.boilout == b.mandelbulb.boilout;
+    case FractalType::kMandelbox:
+      return a.mandelbox.min_radius == b.mandelbox.min_radius &&
+             a.mandelbox.fixed_radius == b.mandelbox.fixed_radius &&
+             a.mandelbox.scale == b.mandelbox.scale;
+    case FractalType::kJuliabulb:
+      return a.juliabulb.c.x == b.juliabulb.c.x &&
+             a.juliabulb.c.y == b.juliabulb.c.y &&
+             a.juliabulb.c.z == b.juliabulb.c.z &&
+             a.juliabulb.power == b.juliabulb.power;
+    default:
+      return true;
+  }
+}
+
+// Whether a ray may start at the reprojected distance `start`: only if the
+// surface is at least the slack the start was pulled in by away from it.
+// Closer, the start may lie past a surface the last frame did not see, and
+// marching cannot tell, as SDFs such as the Mandelbox's stay positive inside
+// the solid.
+template <FractalType kType>
+bool ReusableStart(const Ray& ray, float start,
+                   const FractalSettings& fractal) {
+  return SignedDistance<kType>(ray.position + ray.direction * start,
+                               fractal) >= kDepthReuseSlack * start;
+}
+
+// Lowers `*target` to the bits of `value`. Non-negative floats compare like
+// their bit patterns, so no float atomics are needed.
+void AtomicMin(uint32_t* target, float value) {
+  std::atomic_ref<uint32_t> ref(*target);
+  const uint32_t bits = std::bit_cast<uint32_t>(value);
+  uint32_t current = ref.load(std::memory_order_relaxed);
+  while (bits < current &&
+         !ref.compare_exchange_weak(current, bits, std::memory_order_relaxed)) {
+  }
+}
 
-void CPURenderer::Init(uint32_t target_tex_id) { target_ = target_tex_id; }
+}  // namespace
+
+CPURenderer::CPURenderer() : CPURenderer(CPURendererOptions{}) {}
+
+CPURenderer::CPURenderer(const CPURendererOptions& options)
+    : tile_size_(options.tile_size == 0 ? 32 : options.tile_size),
+      kernels_(&GetEscapeTimeKernels(
+          std::min(options.simd, DetectSimdLevel()))),
+      march_(GetPacketMarcher(std::min(options.simd, DetectSimdLevel()))),
+      normals_(options.normals),
+      subdivision_(options.subdivision),
+      antialias_(options.antialias),
+      cone_prepass_(options.cone_prepass),
+      pool_(options.threads),
+      reuse_depth_(options.reuse_depth),
+      incremental_pan_(options.incremental_pan),
+      tile_cache_(options.tile_cache_bytes) {}
+
+void CPURenderer::Init(uint32_t) {}
 
 void CPURenderer::Resize(uint32_t w, uint32_t h) {
   width_ = w;
   height_ = h;
+  frame_width_ = w;
+  frame_height_ = h;
+  crop_x_ = 0;
+  crop_y_ = 0;
 
   buffer_.resize(w * h);
+  depth_valid_ = false;
+  pan_valid_ = false;
+}
+
+void CPURenderer::SetCrop(uint32_t frame_width, uint32_t frame_height,
+                          uint32_t x, uint32_t y) {
+  frame_width_ = frame_width;
+  frame_height_ = frame_height;
+  crop_x_ = x;
+  crop_y_ = y;
+
+  depth_valid_ = false;
+  pan_valid_ = false;
 }
 
 void CPURenderer::Render() {
-  if (target_ == 0 || width_ == 0 || height_ == 0) {
+  if (!settings_) {
+    return;
+  }
+
+  RenderFrame(settings_->GetSettings());
+}
+
+bool CPURenderer::Present(FrameStats*) { return false; }
+
+void CPURenderer::RenderFrame(const RenderSettings& settings) {
+  RenderFrameTo(settings, buffer_.data());
+}
+
+void CPURenderer::RenderFrame(const RenderSettings& settings, Color* output) {
+  if (!Is2DFractal(settings.fractal.type)) {
+    RenderFrameTo(settings, output);
     return;
   }
 
-  const auto settings = settings_->GetSettings();
+  RenderFrameTo(settings, buffer_.data());
+  std::copy(buffer_.begin(), buffer_.end(), output);
+}
+
+void CPURenderer::RenderFrameTo(const RenderSettings& settings,
+                                Color* output) {
+  if (width_ == 0 || height_ == 0) {
+    return;
+  }
+  TraceSpan span("frame");
+  output_ = output;
+  antialiased_pixels_ = 0;
+
+  heatmap_ = settings.heatmap;
+  if (heatmap_ != Heatmap::kOff) {
+    cost_.resize(width_ * height_);
+  }
+
   if (Is2DFractal(settings.fractal.type)) {
     Render2D(settings);
+    depth_valid_ = false;
   } else {
     Render3D(settings);
+    pan_valid_ = false;
   }
 
-  UploadBufferToTarget();
+  if (heatmap_ != Heatmap::kOff) {
+    FinishHeatmap();
+  }
+}
+
+const std::vector<Color>& CPURenderer::buffer() const { return buffer_; }
+uint32_t CPURenderer::subdivision_errors() const {
+  return subdivision_errors_;
+}
+uint32_t CPURenderer::antialiased_pixels() const {
+  return antialiased_pixels_;
 }
+const CostStats& CPURenderer::cost_stats() const { return cost_stats_; }
+TileCache::Stats CPURenderer::tile_cache_stats() const {
+  return tile_cache_.stats();
+}
+void CPURenderer::ClearTileCache() { tile_cache_.Clear(); }
+uint32_t CPURenderer::width() const { return width_; }
+uint32_t CPURenderer::height() const { return height_; }
 
 void CPURenderer::Render2D(const RenderSettings& settings) {
-  for (uint32_t y = 0; y < height_; ++y) {
-    for (uint32_t x = 0; x < width_; ++x) {
-      const auto pos = PixelToPosition(x, y, width_, height_, settings.camera);
+  subdivision_errors_ = 0;
 
-      int iteration;
-      if (settings.fractal.type == FractalType::kMandelbrot) {
-        iteration =
-            MandelbrotIterations(pos.x, pos.y, settings.fractal.max_iterations);
-      } else if (settings.fractal.type == FractalType::kJulia) {
-        iteration = JuliaIterations(
-            pos.x, pos.y, settings.fractal.max_iterations,
-            settings.fractal.julia.c_re, settings.fractal.julia.c_im);
-      }
-      Color& c = buffer_[y * width_ + x];
+  // A whole-pixel pan keeps the pixels still in view and renders only the
+  // rows and columns it exposed. Heatmaps cost every pixel, and
+  // anti-aliasing needs every escape count, so they render the whole frame,
+  // as do crops.
+  const bool heatmap = heatmap_ != Heatmap::kOff;
+  const bool antialias = antialias_ > 0;
+  const bool cropped = width_ != frame_width_ || height_ != frame_height_;
+  if (antialias) {
+    iterations_.resize(width_ * height_);
+  }
+  int32_t dx = 0;
+  int32_t dy = 0;
+  std::vector<Tile> tiles;
+  if (pan_valid_ && !heatmap && !antialias &&
+      PanOffset(pan_settings_, settings, width_, height_, &dx, &dy)) {
+    if (dx != 0 || dy != 0) {
+      ShiftBuffer(dx, dy);
+    }
+    const uint32_t columns = std::abs(dx);
+    const uint32_t rows = std::abs(dy);
+    const uint32_t kept_x0 = dx < 0 ? columns : 0;
+    const uint32_t kept_x1 = dx > 0 ? width_ - columns : width_;
+    if (dx < 0) {
+      AppendTiles({0, 0, columns, height_}, &tiles);
+    } else if (dx > 0) {
+      AppendTiles({kept_x1, 0, width_, height_}, &tiles);
+    }
+    if (dy < 0) {
+      AppendTiles({kept_x0, 0, kept_x1, rows}, &tiles);
+    } else if (dy > 0) {
+      AppendTiles({kept_x0, height_ - rows, kept_x1, height_}, &tiles);
+    }
+  } else {
+    AppendTiles({0, 0, width_, height_}, &tiles);
+  }
+
+  const auto& view2d = settings.view2d;
+  const auto precision =
+      ChoosePrecision(view2d, settings.camera.aspect, frame_height_);
+  const bool deep_zoom =
+      settings.fractal.type == FractalType::kMandelbrot &&
+      (view2d.deep_zoom || precision == Precision2D::kPerturbation);
 
-      c = ColorFromIter(iteration, settings.fractal.max_iterations);
+  // Frames on the pixel lattice of a cached level are assembled from cached
+  // tiles, and the tiles they miss are added. The deep-zoom path fixes
+  // glitches across the whole frame and is not cached.
+  TileLevel level;
+  level.type = settings.fractal.type;
+  level.max_iterations = settings.fractal.max_iterations;
+  level.julia = settings.fractal.julia;
+  level.spacing_x =
+      2.0 * settings.camera.aspect * view2d.scale / frame_width_;
+  level.spacing_y = 2.0 * view2d.scale / frame_height_;
+  level.precision = static_cast<uint8_t>(precision);
+  level.tile_size = tile_size_;
+  uint32_t level_id = 0;
+  int64_t lattice_x = 0;
+  int64_t lattice_y = 0;
+  const bool cached =
+      tile_cache_.enabled() && !heatmap && !antialias && !deep_zoom &&
+      !tiles.empty() &&
+      tile_cache_.Align(
+          level,
+          view2d.center_x - FixedPoint::FromDouble(0.5 * frame_width_ *
+                                                   level.spacing_x),
+          view2d.center_y - FixedPoint::FromDouble(0.5 * frame_height_ *
+                                                   level.spacing_y),
+          &level_id, &lattice_x, &lattice_y);
+  // Align placed the frame's top left pixel; the buffer starts at the crop.
+  lattice_x += crop_x_;
+  lattice_y += crop_y_;
+
+  const auto render_tiles = [&](const auto& view) {
+    if (cached) {
+      RenderCachedTiles(settings, view, tiles, level_id, lattice_x,
+                        lattice_y);
+      return;
+    }
+    pool_.ParallelFor(tiles.size(), [&](uint32_t index, uint32_t) {
+      const Tile& tile = tiles[index];
+      RenderTile2D(settings, view, tile.x0, tile.y0, tile.x1 - tile.x0,
+                   tile.y1 - tile.y0, &buffer_[tile.y0 * width_ + tile.x0],
+                   width_);
+    });
+    if (antialias) {
+      Antialias2D(settings, view);
     }
+  };
+
+  if (tiles.empty()) {
+    // Nothing moved.
+  } else if (deep_zoom) {
+    RenderDeepZoom(settings, tiles);
+  } else if (precision == Precision2D::kFloat) {
+    render_tiles(MakePlaneView<float>(settings));
+  } else if (precision == Precision2D::kDouble) {
+    render_tiles(MakePlaneView<double>(settings));
+  } else {
+    // Julia has no perturbation path and stays on double-double.
+    render_tiles(MakePlaneView<DoubleDouble>(settings));
   }
+
+  pan_settings_ = settings;
+  pan_valid_ = incremental_pan_ && !heatmap && !antialias && !cropped;
 }
 
 void CPURenderer::Render3D(const RenderSettings& settings) {
-  for (uint32_t y = 0; y < height_; ++y) {
-    for (uint32_t x = 0; x < width_; ++x) {
-      Color& color = buffer_[y * width_ + x];
-      color = {0, 0, 0, 255};
-
-      const auto ray = MakeRay(x, y, width_, height_, settings.camera);
-      float t = 0.0f;
-
-      for (int i = 0; i < 100; ++i) {
-        const auto pos = ray.position + ray.direction * t;
-        const auto distance = CalculateSignedDistance(pos, settings);
-
-        if (distance < 0.001 * t) {
-          const auto n = GetNormal(pos, settings);
-          color = render::GetFractalColor(pos, n, settings.fractal);
-          break;
+  const bool reuse = reuse_depth_ && depth_valid_ &&
+                     SameSurface(settings.fractal, depth_fractal_);
+  if (reuse_depth_) {
+    depth_.resize(width_ * height_);
+  }
+  if (reuse) {
+    ReprojectDepth(settings.camera);
+  }
+  if (antialias_ > 0) {
+    edge_samples_.resize(width_ * height_);
+  }
+
+  DispatchFractal3D(settings.fractal.type, [&](auto type) {
+    pool_.ParallelFor(TileCount(), [&](uint32_t index, uint32_t) {
+      TraceSpan span("tile_3d");
+      RenderTile3D<decltype(type)::value>(
+          settings, reuse ? start_t_.data() : nullptr, GetTile(index));
+    });
+    if (antialias_ > 0) {
+      Antialias3D<decltype(type)::value>(settings);
+    }
+  });
+
+  depth_camera_ = settings.camera;
+  depth_fractal_ = settings.fractal;
+  depth_valid_ = reuse_depth_;
+}
+
+void CPURenderer::ReprojectDepth(const CameraSettings& camera) {
+  TraceSpan span("reproject");
+  reprojected_.assign(width_ * height_, kNoReprojectedDepth);
+  start_t_.resize(width_ * height_);
+
+  // Scatter the hit points of the last frame's rays into the new view,
+  // keeping the nearest one per pixel. Everything in front of them is empty.
+  // Escaped rays are left out: near silhouettes their far ends reproject
+  // onto rays that pass through the surface first.
+  pool_.ParallelFor(TileCount(), [&](uint32_t index, uint32_t) {
+    const Tile tile = GetTile(index);
+    for (uint32_t y = tile.y0; y < tile.y1; ++y) {
+      for (uint32_t x = tile.x0; x < tile.x1; ++x) {
+        const float t = depth_[y * width_ + x];
+        if (t <= 0.0f) {
+          continue;
+        }
+
+        const Ray ray = MakeRay(crop_x_ + x, crop_y_ + y, frame_width_,
+                                frame_height_, depth_camera_);
+        const Vector3d end = ray.position + ray.direction * t;
+        float px;
+        float py;
+        if (!PositionToPixel(end, frame_width_, frame_height_, camera, &px,
+                             &py)) {
+          continue;
         }
-        if (distance > 2.0f) {
-          color = {100, 100, 100, 255};
-          break;
+        px -= crop_x_;
+        py -= crop_y_;
+        if (px < 0.0f || py < 0.0f || px >= width_ || py >= height_) {
+          continue;
         }
+        AtomicMin(&reprojected_[static_cast<uint32_t>(py) * width_ +
+                                static_cast<uint32_t>(px)],
+                  Length(end - camera.position));
+      }
+    }
+  });
+
+  // A ray starts short of the nearest end point reprojected into its 3x3
+  // neighbourhood, which also covers one-pixel holes in the scatter. Pixels
+  // with none nearby march from 0. Backing off by the camera's travel keeps
+  // surfaces between the old and new eye, which the last frame could not
+  // see, in front of the start.
+  const float travel = Length(camera.position - depth_camera_.position);
+  pool_.ParallelFor(TileCount(), [&](uint32_t index, uint32_t) {
+    const Tile tile = GetTile(index);
+    for (uint32_t y = tile.y0; y < tile.y1; ++y) {
+      const uint32_t y0 = y > 0 ? y - 1 : 0;
+      const uint32_t y1 = std::min(y + 1, height_ - 1);
+      for (uint32_t x = tile.x0; x < tile.x1; ++x) {
+        const uint32_t x0 = x > 0 ? x - 1 : 0;
+        const uint32_t x1 = std::min(x + 1, width_ - 1);
+
+        uint32_t nearest = kNoReprojectedDepth;
+        for (uint32_t ny = y0; ny <= y1; ++ny) {
+          for (uint32_t nx = x0; nx <= x1; ++nx) {
+            nearest = std::min(nearest, reprojected_[ny * width_ + nx]);
+          }
+        }
+
+        float start = 0.0f;
+        if (nearest != kNoReprojectedDepth) {
+          start = std::bit_cast<float>(nearest) * (1.0f - kDepthReuseSlack) -
+                  travel;
+        }
+        start_t_[y * width_ + x] = std::max(start, 0.0f);
+      }
+    }
+  });
+}
+
+void CPURenderer::RenderDeepZoom(const RenderSettings& settings,
+                                 const std::vector<Tile>& tiles) {
+  const auto& view = settings.view2d;
+  const int max_iter = settings.fractal.max_iterations;
+  const double aspect = settings.camera.aspect;
+
+  // Offsets from the view center, mapped like PixelToPosition. They are
+  // tiny but well inside double range, so only the center needs FixedPoint.
+  const auto offset_x = [&](uint32_t x) {
+    return ((crop_x_ + x + 0.5) / frame_width_ * 2.0 - 1.0) * aspect *
+           view.scale;
+  };
+  const auto offset_y = [&](uint32_t y) {
+    return ((crop_y_ + y + 0.5) / frame_height_ * 2.0 - 1.0) * view.scale;
+  };
+
+  iterations_.resize(width_ * height_);
+  std::vector<std::vector<uint32_t>> glitched(pool_.size());
+
+  double ref_x = 0.0;
+  double ref_y = 0.0;
+  ReferenceOrbit orbit =
+      ComputeReferenceOrbit(view.center_x, view.center_y, max_iter);
+
+  // Iterates `count` pixels given by their buffer index against `orbit`.
+  const auto iterate = [&](const uint32_t* pixels, uint32_t count,
+                           uint32_t worker) {
+    std::vector<double> dc_re(count);
+    std::vector<double> dc_im(count);
+    std::vector<int> counts(count);
+    std::vector<uint8_t> lost(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      dc_re[i] = offset_x(pixels[i] % width_) - ref_x;
+      dc_im[i] = offset_y(pixels[i] / width_) - ref_y;
+    }
+
+    kernels_->perturbed(orbit.re.data(), orbit.im.data(),
+                        static_cast<int>(orbit.re.size()), dc_re.data(),
+                        dc_im.data(), count, max_iter, counts.data(),
+                        lost.data());
+
+    for (uint32_t i = 0; i < count; ++i) {
+      iterations_[pixels[i]] = counts[i];
+      if (lost[i]) {
+        glitched[worker].push_back(pixels[i]);
+      }
+    }
+  };
+
+  pool_.ParallelFor(tiles.size(), [&](uint32_t index, uint32_t worker) {
+    TraceSpan span("perturb_tile");
+    const Tile& tile = tiles[index];
+    std::vector<uint32_t> row(tile.x1 - tile.x0);
+    for (uint32_t y = tile.y0; y < tile.y1; ++y) {
+      for (uint32_t x = tile.x0; x < tile.x1; ++x) {
+        row[x - tile.x0] = y * width_ + x;
+      }
+      iterate(row.data(), row.size(), worker);
+    }
+  });
+
+  // Rebase glitched pixels onto a new reference placed among them. The
+  // reference pixel itself never glitches, so every round makes progress.
+  std::vector<uint32_t> pending;
+  for (int reference = 1; reference < kMaxReferences; ++reference) {
+    pending.clear();
+    for (auto& list : glitched) {
+      pending.insert(pending.end(), list.begin(), list.end());
+      list.clear();
+    }
+    if (pending.empty()) {
+      break;
+    }
 
-        t += distance;
+    // The glitched pixel closest to the centroid of all glitched pixels.
+    double mean_x = 0.0;
+    double mean_y = 0.0;
+    for (uint32_t pixel : pending) {
+      mean_x += pixel % width_;
+      mean_y += pixel / width_;
+    }
+    mean_x /= pending.size();
+    mean_y /= pending.size();
+
+    uint32_t best = pending[0];
+    double best_distance = -1.0;
+    for (uint32_t pixel : pending) {
+      const double dx = pixel % width_ - mean_x;
+      const double dy = pixel / width_ - mean_y;
+      const double distance = dx * dx + dy * dy;
+      if (best_distance < 0.0 || distance < best_distance) {
+        best = pixel;
+        best_distance = distance;
       }
     }
+
+    ref_x = offset_x(best % width_);
+    ref_y = offset_y(best / width_);
+    orbit = ComputeReferenceOrbit(view.center_x + FixedPoint::FromDouble(ref_x),
+                                  view.center_y + FixedPoint::FromDouble(ref_y),
+                                  max_iter);
+
+    const uint32_t chunks = (pending.size() + kGlitchChunk - 1) / kGlitchChunk;
+    pool_.ParallelFor(chunks, [&](uint32_t chunk, uint32_t worker) {
+      TraceSpan span("glitch_chunk");
+      const size_t begin = static_cast<size_t>(chunk) * kGlitchChunk;
+      const size_t end = std::min(begin + kGlitchChunk, pending.size());
+      iterate(&pending[begin], end - begin, worker);
+    });
   }
+
+  pool_.ParallelFor(tiles.size(), [&](uint32_t index, uint32_t) {
+    TraceSpan span("color_tile");
+    const Tile& tile = tiles[index];
+    for (uint32_t y = tile.y0; y < tile.y1; ++y) {
+      for (uint32_t x = tile.x0; x < tile.x1; ++x) {
+        const uint32_t pixel = y * width_ + x;
+        if (heatmap_ != Heatmap::kOff) {
+          cost_[pixel] = iterations_[pixel];
+        } else {
+          buffer_[pixel] = ColorFromIter(iterations_[pixel], max_iter);
+        }
+      }
+    }
+  });
 }
 
-void CPURenderer::UploadBufferToTarget() const {
-  if (target_ == 0) {
+template <typename T>
+void CPURenderer::RenderTile2D(const RenderSettings& settings,
+                               const PlaneView<T>& view, int32_t x0,
+                               int32_t y0, uint32_t tile_width,
+                               uint32_t tile_height, Color* out,
+                               uint32_t stride) {
+  TraceSpan span("tile_2d");
+  const int max_iter = settings.fractal.max_iterations;
+
+  // Escape counts of the tile, indexed by tile-local pixel.
+  std::vector<int> counts(tile_width * tile_height, kNotIterated);
+
+  std::vector<T> xs;
+  std::vector<T> ys;
+  std::vector<int> batch_counts;
+  // Iterates the tile-local `pixels` into `out`, which is indexed like
+  // `counts`.
+  const auto iterate = [&](const std::vector<uint32_t>& pixels, int* out) {
+    xs.resize(pixels.size());
+    ys.resize(pixels.size());
+    batch_counts.resize(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i) {
+      PixelToPosition(
+          crop_x_ + x0 + static_cast<int32_t>(pixels[i] % tile_width),
+          crop_y_ + y0 + static_cast<int32_t>(pixels[i] / tile_width),
+          frame_width_, frame_height_, view, &xs[i], &ys[i]);
+    }
+    IteratePoints(*kernels_, settings.fractal, xs.data(), ys.data(),
+                  pixels.size(), batch_counts.data());
+    for (size_t i = 0; i < pixels.size(); ++i) {
+      out[pixels[i]] = batch_counts[i];
+    }
+  };
+
+  // Iterates every pixel, row by row.
+  const auto iterate_all = [&](int* out) {
+    std::vector<uint32_t> row(tile_width);
+    for (uint32_t y = 0; y < tile_height; ++y) {
+      for (uint32_t x = 0; x < tile_width; ++x) {
+        row[x] = y * tile_width + x;
+      }
+      iterate(row, out);
+    }
+  };
+
+  if (subdivision_ == Subdivision2D::kOff) {
+    iterate_all(counts.data());
+  } else {
+    SubdivideTile(tile_width, tile_height, &counts,
+                  [&](const std::vector<uint32_t>& pixels) {
+                    iterate(pixels, counts.data());
+                  });
+  }
+
+  if (subdivision_ == Subdivision2D::kVerify) {
+    TraceSpan verify_span("verify");
+    std::vector<int> expected(counts.size());
+    iterate_all(expected.data());
+    uint32_t errors = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+      errors += counts[i] != expected[i];
+    }
+    subdivision_errors_ += errors;
+  }
+
+  if (antialias_ > 0) {
+    // Anti-aliased frames render uncached tiles, which lie inside the frame.
+    for (uint32_t y = 0; y < tile_height; ++y) {
+      std::copy_n(&counts[y * tile_width], tile_width,
+                  &iterations_[(y0 + y) * width_ + x0]);
+    }
+  }
+
+  if (heatmap_ != Heatmap::kOff) {
+    // Heatmap frames render uncached tiles, which lie inside the frame.
+    for (uint32_t y = 0; y < tile_height; ++y) {
+      std::copy_n(&counts[y * tile_width], tile_width,
+                  &cost_[(y0 + y) * width_ + x0]);
+    }
     return;
   }
 
-  QOpenGLFunctions* gl = QOpenGLContext::currentContext()->functions();
+  for (uint32_t y = 0; y < tile_height; ++y) {
+    Color* row = out + y * stride;
+    for (uint32_t x = 0; x < tile_width; ++x) {
+      row[x] = ColorFromIter(counts[y * tile_width + x], max_iter);
+    }
+  }
+}
+
+template <typename T>
+void CPURenderer::RenderCachedTiles(const RenderSettings& settings,
+                                    const PlaneView<T>& view,
+                                    const std::vector<Tile>& regions,
+                                    uint32_t level_id, int64_t lattice_x,
+                                    int64_t lattice_y) {
+  const int64_t size = tile_size_;
+  const auto floor_div = [size](int64_t value) {
+    return value >= 0 ? value / size : -((size - 1 - value) / size);
+  };
+
+  // Lattice tiles over the regions. Neighbouring regions can share tiles.
+  std::vector<std::pair<int64_t, int64_t>> tiles;
+  for (const Tile& region : regions) {
+    const int64_t tx0 = floor_div(lattice_x + region.x0);
+    const int64_t tx1 = floor_div(lattice_x + region.x1 - 1);
+    const int64_t ty0 = floor_div(lattice_y + region.y0);
+    const int64_t ty1 = floor_div(lattice_y + region.y1 - 1);
+    for (int64_t ty = ty0; ty <= ty1; ++ty) {
+      for (int64_t tx = tx0; tx <= tx1; ++tx) {
+        tiles.emplace_back(tx, ty);
+      }
+    }
+  }
+  std::sort(tiles.begin(), tiles.end());
+  tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+
+  pool_.ParallelFor(tiles.size(), [&](uint32_t index, uint32_t) {
+    TraceSpan span("cached_tile");
+    const auto [tx, ty] = tiles[index];
+    // Frame pixel of the tile's top left corner, possibly outside the frame.
+    const int64_t x0 = tx * size - lattice_x;
+    const int64_t y0 = ty * size - lattice_y;
+
+    std::vector<Color> pixels(size * size);
+    if (!tile_cache_.Find(level_id, tx, ty, pixels.data())) {
+      RenderTile2D(settings, view, static_cast<int32_t>(x0),
+                   static_cast<int32_t>(y0), size, size, pixels.data(), size);
+      tile_cache_.Insert(level_id, tx, ty, pixels.data());
+    }
+
+    const int64_t x1 = std::min<int64_t>(x0 + size, width_);
+    const int64_t y1 = std::min<int64_t>(y0 + size, height_);
+    const int64_t first_x = std::max<int64_t>(x0, 0);
+    for (int64_t y = std::max<int64_t>(y0, 0); y < y1; ++y) {
+      const Color* row = &pixels[(y - y0) * size];
+      std::copy(row + (first_x - x0), row + (x1 - x0),
+                &buffer_[y * width_ + first_x]);
+    }
+  });
+}
+
+template <FractalType kType>
+void CPURenderer::RenderTile3D(const RenderSettings& settings,
+                               const float* start_t, const Tile& tile) {
+  const uint32_t count = tile.x1 - tile.x0;
+
+  // Optional cone pre-pass: march the tile's cone, then the cones of its
+  // blocks from where the tile's cone stopped. Blocks whose cone escapes are
+  // background. The cones are those of the frame's tile around this one, in
+  // frame pixels, so a crop that cuts the tile marches what the whole frame
+  // does. Without it every block starts at 0.
+  const uint32_t frame_x0 = (crop_x_ + tile.x0) / tile_size_ * tile_size_;
+  const uint32_t frame_y0 = (crop_y_ + tile.y0) / tile_size_ * tile_size_;
+  const uint32_t frame_x1 = std::min(frame_x0 + tile_size_, frame_width_);
+  const uint32_t frame_y1 = std::min(frame_y0 + tile_size_, frame_height_);
+  const uint32_t blocks_x = (frame_x1 - frame_x0 + kConeBlock - 1) / kConeBlock;
+  const uint32_t blocks_y = (frame_y1 - frame_y0 + kConeBlock - 1) / kConeBlock;
+  // Block of frame pixel (x, y).
+  const auto block_of = [&](uint32_t x, uint32_t y) {
+    return (y - frame_y0) / kConeBlock * blocks_x +
+           (x - frame_x0) / kConeBlock;
+  };
+  std::vector<float> block_t(blocks_x * blocks_y);
+  std::vector<uint8_t> block_escaped(blocks_x * blocks_y);
+  if (cone_prepass_) {
+    TraceSpan span("cone");
+    bool tile_escaped;
+    const float tile_t =
+        ConeMarch<kType>(MakeCone(frame_x0, frame_y0, frame_x1, frame_y1,
+                                  frame_width_, frame_height_,
+                                  settings.camera),
+                         0.0f, settings.fractal, kConeSteps,
+                         kMarchLimits.max_distance, &tile_escaped);
+    std::fill(block_t.begin(), block_t.end(), tile_t);
+    std::fill(block_escaped.begin(), block_escaped.end(), tile_escaped);
+
+    // Only the blocks the tile overlaps.
+    const uint32_t first = block_of(crop_x_ + tile.x0, crop_y_ + tile.y0);
+    const uint32_t last =
+        block_of(crop_x_ + tile.x1 - 1, crop_y_ + tile.y1 - 1);
+    for (uint32_t by = first / blocks_x; by <= last / blocks_x && !tile_escaped;
+         ++by) {
+      for (uint32_t bx = first % blocks_x; bx <= last % blocks_x; ++bx) {
+        const uint32_t x0 = frame_x0 + bx * kConeBlock;
+        const uint32_t y0 = frame_y0 + by * kConeBlock;
+        const Cone cone =
+            MakeCone(x0, y0, std::min(x0 + kConeBlock, frame_x1),
+                     std::min(y0 + kConeBlock, frame_y1), frame_width_,
+                     frame_height_, settings.camera);
+        bool escaped;
+        block_t[by * blocks_x + bx] =
+            ConeMarch<kType>(cone, tile_t, settings.fractal, kConeSteps,
+                             kMarchLimits.max_distance, &escaped);
+        block_escaped[by * blocks_x + bx] = escaped;
+      }
+    }
+  }
+
+  // The tile's rays are generated, marched and shaded in one batch each.
+  const uint32_t pixels = count * (tile.y1 - tile.y0);
+  std::vector<Ray> rays(pixels);
+  std::vector<float> starts(pixels);
+  std::vector<uint32_t> offsets(pixels);
+  std::vector<MarchResult> results(pixels);
+
+  uint32_t marched = 0;
+  {
+    TraceSpan span("rays");
+    for (uint32_t y = tile.y0; y < tile.y1; ++y) {
+      for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t offset = y * width_ + tile.x0 + i;
+        const uint32_t block = block_of(crop_x_ + tile.x0 + i, crop_y_ + y);
+        if (block_escaped[block]) {
+          output_[offset] = kBackgroundColor;
+          if (reuse_depth_) {
+            depth_[offset] = 0.0f;
+          }
+          if (antialias_ > 0) {
+            edge_samples_[offset] = {block_t[block], block_t[block],
+                                     MarchStatus::kEscaped, {},
+                                     kBackgroundColor};
+          }
+          if (heatmap_ != Heatmap::kOff) {
+            cost_[offset] = 0;
+          }
+          continue;
+        }
+
+        rays[marched] = MakeRay(crop_x_ + tile.x0 + i, crop_y_ + y,
+                                frame_width_, frame_height_, settings.camera);
+        starts[marched] = block_t[block];
+        if (start_t && start_t[offset] > block_t[block] &&
+            ReusableStart<kType>(rays[marched], start_t[offset],
+                                 settings.fractal)) {
+          starts[marched] = start_t[offset];
+        }
+        offsets[marched] = offset;
+        ++marched;
+      }
+    }
+  }
+
+  {
+    TraceSpan span("march");
+    march_(rays.data(), starts.data(), marched, settings,
+           MakeMarchLimits(settings), results.data());
+  }
+
+  TraceSpan span("shade");
+  const uint32_t normal_evaluations = NormalEvaluations<kType>(normals_);
+  for (uint32_t j = 0; j < marched; ++j) {
+    const uint32_t offset = offsets[j];
+    if (reuse_depth_) {
+      depth_[offset] =
+          results[j].status == MarchStatus::kHit ? results[j].t : 0.0f;
+    }
+    if (heatmap_ != Heatmap::kOff) {
+      const bool normal = heatmap_ == Heatmap::kEvaluations &&
+                          results[j].status == MarchStatus::kHit;
+      cost_[offset] = results[j].steps + (normal ? normal_evaluations : 0);
+    }
+
+    Vector3d normal{};
+    output_[offset] = ShadeRay<kType>(rays[j], results[j], settings.fractal,
+                                      normals_, &normal);
+    if (antialias_ > 0) {
+      edge_samples_[offset] = {starts[j], results[j].t, results[j].status,
+                               normal, output_[offset]};
+    }
+  }
+}
+
+template <typename T>
+void CPURenderer::Antialias2D(const RenderSettings& settings,
+                              const PlaneView<T>& view) {
+  const int max_iter = settings.fractal.max_iterations;
+  const auto differs = [this, max_iter](uint32_t a, uint32_t b) {
+    const int p = iterations_[a];
+    const int q = iterations_[b];
+    return (p == max_iter) != (q == max_iter) ||
+           std::abs(p - q) * kEdgeLevels > max_iter;
+  };
+
+  pool_.ParallelFor(TileCount(), [&](uint32_t index, uint32_t) {
+    TraceSpan span("antialias_tile");
+    const Tile tile = GetTile(index);
+    std::vector<uint32_t> edges;
+    AppendEdges(tile.x0, tile.y0, tile.x1, tile.y1, width_, height_, differs,
+                &edges);
+    if (edges.empty()) {
+      return;
+    }
+
+    // The samples of all the tile's edge pixels are iterated in one batch.
+    const uint32_t count = edges.size() * antialias_;
+    std::vector<T> xs(count);
+    std::vector<T> ys(count);
+    std::vector<int> counts(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t pixel = edges[i / antialias_];
+      double sx;
+      double sy;
+      SampleOffset(FramePixel(pixel), i % antialias_, &sx, &sy);
+      PixelToPosition(crop_x_ + pixel % width_, crop_y_ + pixel / width_,
+                      frame_width_, frame_height_, view, &xs[i], &ys[i], sx,
+                      sy);
+    }
+    IteratePoints(*kernels_, settings.fractal, xs.data(), ys.data(), count,
+                  counts.data());
+
+    for (uint32_t e = 0; e < edges.size(); ++e) {
+      const uint32_t pixel = edges[e];
+      const int* samples = &counts[e * antialias_];
+      if (heatmap_ != Heatmap::kOff) {
+        for (uint32_t i = 0; i < antialias_; ++i) {
+          cost_[pixel] += samples[i];
+        }
+        continue;
+      }
+      ColorSum sum;
+      sum.Add(ColorFromIter(iterations_[pixel], max_iter));
+      for (uint32_t i = 0; i < antialias_; ++i) {
+        sum.Add(ColorFromIter(samples[i], max_iter));
+      }
+      buffer_[pixel] = sum.Average(antialias_ + 1);
+    }
+    antialiased_pixels_ += edges.size();
+  });
+}
+
+template <FractalType kType>
+void CPURenderer::Antialias3D(const RenderSettings& settings) {
+  const uint32_t normal_evaluations = NormalEvaluations<kType>(normals_);
+  const auto differs = [this](uint32_t a, uint32_t b) {
+    const EdgeSample& p = edge_samples_[a];
+    const EdgeSample& q = edge_samples_[b];
+    if (p.status != q.status) {
+      return true;
+    }
+    return p.status == MarchStatus::kHit &&
+           (std::fabs(p.t - q.t) > kEdgeDepth * std::min(p.t, q.t) ||
+            Dot(p.normal, q.normal) < kEdgeCosine ||
+            std::abs(p.color.r - q.color.r) > kEdgeContrast ||
+            std::abs(p.color.g - q.color.g) > kEdgeContrast ||
+            std::abs(p.color.b - q.color.b) > kEdgeContrast);
+  };
+
+  pool_.ParallelFor(TileCount(), [&](uint32_t index, uint32_t) {
+    TraceSpan span("antialias_tile");
+    const Tile tile = GetTile(index);
+    std::vector<uint32_t> edges;
+    AppendEdges(tile.x0, tile.y0, tile.x1, tile.y1, width_, height_, differs,
+                &edges);
+    if (edges.empty()) {
+      return;
+    }
+
+    // The samples of all the tile's edge pixels are marched in one batch,
+    // each from where its pixel's ray started.
+    const uint32_t count = edges.size() * antialias_;
+    std::vector<Ray> rays(count);
+    std::vector<float> starts(count);
+    std::vector<MarchResult> results(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t pixel = edges[i / antialias_];
+      double sx;
+      double sy;
+      SampleOffset(FramePixel(pixel), i % antialias_, &sx, &sy);
+      rays[i] = MakeRay(crop_x_ + pixel % width_, crop_y_ + pixel / width_,
+                        frame_width_, frame_height_, settings.camera, sx, sy);
+      starts[i] = edge_samples_[pixel].start;
+    }
+    march_(rays.data(), starts.data(), count, settings,
+           MakeMarchLimits(settings), results.data());
+
+    for (uint32_t e = 0; e < edges.size(); ++e) {
+      const uint32_t pixel = edges[e];
+      ColorSum sum;
+      sum.Add(edge_samples_[pixel].color);
+      uint32_t cost = 0;
+      for (uint32_t i = e * antialias_; i < (e + 1) * antialias_; ++i) {
+        Vector3d normal;
+        sum.Add(ShadeRay<kType>(rays[i], results[i], settings.fractal,
+                                normals_, &normal));
+        const bool hit = results[i].status == MarchStatus::kHit;
+        cost += results[i].steps +
+                (heatmap_ == Heatmap::kEvaluations && hit ? normal_evaluations
+                                                          : 0);
+      }
+      if (heatmap_ != Heatmap::kOff) {
+        cost_[pixel] += cost;
+      }
+      output_[pixel] = sum.Average(antialias_ + 1);
+    }
+    antialiased_pixels_ += edges.size();
+  });
+}
+
+uint32_t CPURenderer::TileCount() const {
+  const uint32_t tiles_x =
+      (crop_x_ % tile_size_ + width_ + tile_size_ - 1) / tile_size_;
+  const uint32_t tiles_y =
+      (crop_y_ % tile_size_ + height_ + tile_size_ - 1) / tile_size_;
+  return tiles_x * tiles_y;
+}
 
-  gl->glBindTexture(GL_TEXTURE_2D, target_);
+CPURenderer::Tile CPURenderer::GetTile(uint32_t index) const {
+  // Tiles lie on the grid of the whole frame, so a crop's tiles are those
+  // of the frame, cut at the crop's edges.
+  const uint32_t skip_x = crop_x_ % tile_size_;
+  const uint32_t skip_y = crop_y_ % tile_size_;
+  const uint32_t tiles_x = (skip_x + width_ + tile_size_ - 1) / tile_size_;
+  const uint32_t grid_x = (index % tiles_x) * tile_size_;
+  const uint32_t grid_y = (index / tiles_x) * tile_size_;
 
-  gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  Tile tile;
+  tile.x0 = std::max(grid_x, skip_x) - skip_x;
+  tile.y0 = std::max(grid_y, skip_y) - skip_y;
+  tile.x1 = std::min(grid_x + tile_size_ - skip_x, width_);
+  tile.y1 = std::min(grid_y + tile_size_ - skip_y, height_);
+  return tile;
+}
 
-  gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA,
-                      GL_UNSIGNED_BYTE, buffer_.data());
+void CPURenderer::AppendTiles(const Tile& region,
+                              std::vector<Tile>* tiles) const {
+  // Next line of the frame's tile grid after buffer coordinate `value`.
+  const auto next = [this](uint32_t value, uint32_t crop) {
+    return ((value + crop) / tile_size_ + 1) * tile_size_ - crop;
+  };
+  for (uint32_t y = region.y0; y < region.y1;) {
+    const uint32_t y1 = std::min(next(y, crop_y_), region.y1);
+    for (uint32_t x = region.x0; x < region.x1;) {
+      const uint32_t x1 = std::min(next(x, crop_x_), region.x1);
+      tiles->push_back({x, y, x1, y1});
+      x = x1;
+    }
+    y = y1;
+  }
+}
 
-  gl->glBindTexture(GL_TEXTURE_2D, 0);
+uint32_t CPURenderer::FramePixel(uint32_t pixel) const {
+  return (crop_y_ + pixel / width_) * frame_width_ + crop_x_ + pixel % width_;
+}
+
+void CPURenderer::FinishHeatmap() {
+  TraceSpan span("heatmap");
+  cost_stats_ = ComputeCostStats(cost_);
+
+  const uint32_t scale = cost_stats_.p99;
+  pool_.ParallelFor(TileCount(), [&](uint32_t index, uint32_t) {
+    const Tile tile = GetTile(index);
+    for (uint32_t y = tile.y0; y < tile.y1; ++y) {
+      for (uint32_t x = tile.x0; x < tile.x1; ++x) {
+        output_[y * width_ + x] = HeatmapColor(cost_[y * width_ + x], scale);
+      }
+    }
+  });
+}
+
+void CPURenderer::ShiftBuffer(int32_t dx, int32_t dy) {
+  TraceSpan span("shift");
+  pan_scratch_.resize(buffer_.size());
+  pool_.ParallelFor(TileCount(), [&](uint32_t index, uint32_t) {
+    const Tile tile = GetTile(index);
+    const int64_t x0 = std::max<int64_t>(tile.x0, -dx);
+    const int64_t x1 = std::min<int64_t>(tile.x1, int64_t{width_} - dx);
+    if (x0 >= x1) {
+      return;
+    }
+    for (uint32_t y = tile.y0; y < tile.y1; ++y) {
+      const int64_t source_y = int64_t{y} + dy;
+      if (source_y < 0 || source_y >= height_) {
+        continue;
+      }
+      const Color* source = &buffer_[source_y * width_ + x0 + dx];
+      std::copy(source, source + (x1 - x0), &pan_scratch_[y * width_ + x0]);
+    }
+  });
+  buffer_.swap(pan_scratch_);
 }
 
 void CPURenderer::SetSettingsProvider(SettingsProvider* settings) {
   settings_ = settings;
 }
 
+SettingsProvider* CPURenderer::settings_provider() const { return settings_; }
+
 }  // namespace render
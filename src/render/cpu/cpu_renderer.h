@@ -1,33 +1,241 @@
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include "render/common/types.h"
+#include "render/common/utils.h"
+#include "render/cpu/cpu_features.h"
+#include "render/cpu/escape_time.h"
+#include "render/cpu/heatmap.h"
+#include "render/cpu/packet_march.h"
+#include "render/cpu/thread_pool.h"
+#include "render/cpu/tile_cache.h"
 #include "render/renderer.h"
 
 namespace render {
 
+// How 2D frames choose the pixels they iterate.
+enum class Subdivision2D {
+  // Every pixel.
+  kOff,
+  // Mariani-Silver: each tile is split into rectangles recursively and only
+  // their borders are iterated. A rectangle whose whole border has one
+  // escape count is filled with it.
+  kOn,
+  // kOn, but every pixel is also iterated and the pixels the fill got wrong
+  // are counted in CPURenderer::subdivision_errors().
+  kVerify,
+};
+
+struct CPURendererOptions {
+  // Worker threads, 0 means one per hardware thread.
+  uint32_t threads = 0;
+  // Side of the square tiles the frame is split into.
+  uint32_t tile_size = 32;
+  // Widest SIMD kernels to use, capped by what the CPU supports.
+  SimdLevel simd = SimdLevel::kAVX512;
+  // Start 3D rays at the previous frame's hit depth, reprojected to the new
+  // camera, instead of re-marching the empty space in front of the surface.
+  // Starts the SDF finds too close to a surface are dropped. Off by default:
+  // with starts kept only where that is safe, fly-throughs got no faster.
+  bool reuse_depth = false;
+  // Sphere-trace one cone per 8x8 pixel block before the 3D rays and start
+  // the rays where their block's cone stopped. Faster on the Mandelbulb and
+  // Juliabulb, but not exact: a ray that starts farther along takes other
+  // steps, so some pixels turn from exhausted to hit or shade differently,
+  // and since the cones follow the tiles, the frame depends on tile_size.
+  bool cone_prepass = false;
+  // Pixels iterated for 2D frames outside the deep-zoom path. Subdivision
+  // can miss detail thinner than a rectangle, so it is opt-in.
+  Subdivision2D subdivision = Subdivision2D::kOff;
+  // When a 2D view only moved by whole pixels, shift the last frame and
+  // render just the rows and columns that came into view.
+  bool incremental_pan = true;
+  // Memory budget of the cache of 2D tiles kept across frames, 0 to disable
+  // it.
+  size_t tile_cache_bytes = size_t{256} << 20;
+  // How 3D hits get the normal they are shaded with.
+  NormalMethod normals = NormalMethod::kCentral;
+  // Extra jittered samples averaged into each pixel on an edge, 0 for none.
+  // Edges are pixels whose escape count (2D) or hit, depth, normal or color
+  // (3D) differs much from a neighbour's; the rest keep their single sample.
+  // Anti-aliased 2D frames render every pixel, as the tile cache and pans
+  // keep no escape counts, and deep-zoom frames are not anti-aliased.
+  uint32_t antialias = 0;
+};
+
+// Renders frames into a CPU-side buffer. It does not touch OpenGL, so it can
+// run headless; GLCPURenderer adds the texture upload for the app.
 class CPURenderer : public Renderer {
  public:
   CPURenderer();
+  explicit CPURenderer(const CPURendererOptions& options);
 
   void Init(uint32_t target_tex_id) override;
   void Resize(uint32_t w, uint32_t h) override;
   void Render() override;
+  // There is no texture to present to.
+  bool Present(FrameStats* stats) override;
   void SetSettingsProvider(SettingsProvider* settings) override;
 
+  // Renders one frame with `settings` into buffer().
+  void RenderFrame(const RenderSettings& settings);
+  // Renders one frame with `settings` into `output`, which holds width() x
+  // height() colors. 3D frames are written there directly and leave buffer()
+  // as it was; 2D frames build on the last one in buffer(), so they render
+  // there and are copied.
+  void RenderFrame(const RenderSettings& settings, Color* output);
+  // Makes the buffer, at the size Resize gave it, the crop at (x, y) of a
+  // frame_width x frame_height frame, which must hold it. Later frames
+  // render only the crop, pixel for pixel as the whole frame would, so crops
+  // rendered apart tile into the frame. Resize makes the buffer a whole
+  // frame again. Heatmaps and edges found for anti-aliasing only see the
+  // crop: callers that need a crop's edge pixels right render it with a
+  // one-pixel apron and drop that.
+  void SetCrop(uint32_t frame_width, uint32_t frame_height, uint32_t x,
+               uint32_t y);
+
+  const std::vector<Color>& buffer() const;
+  uint32_t width() const;
+  uint32_t height() const;
+  // Pixels of the last 2D frame whose subdivision fill differs from a full
+  // render. Only counted with Subdivision2D::kVerify.
+  uint32_t subdivision_errors() const;
+  // Pixels of the last frame that got extra samples.
+  uint32_t antialiased_pixels() const;
+  // Per-pixel cost of the last frame rendered with a heatmap.
+  const CostStats& cost_stats() const;
+  // Hits and misses of the 2D tile cache since it was created.
+  TileCache::Stats tile_cache_stats() const;
+  void ClearTileCache();
+
+ protected:
+  SettingsProvider* settings_provider() const;
+
  private:
+  struct Tile {
+    uint32_t x0;
+    uint32_t y0;
+    uint32_t x1;
+    uint32_t y1;
+  };
+
+  // The single sample of a 3D pixel that edges are found from.
+  struct EdgeSample {
+    // Where the ray started and ended.
+    float start;
+    float t;
+    MarchStatus status;
+    // Normal of hits.
+    Vector3d normal;
+    // Orbit traps can change the color sharply across a smooth surface.
+    Color color;
+  };
+
+  // Renders one frame into `output`, for the RenderFrame overloads.
+  void RenderFrameTo(const RenderSettings& settings, Color* output);
   void Render2D(const RenderSettings& settings);
   void Render3D(const RenderSettings& settings);
-  void UploadBufferToTarget() const;
+  void RenderDeepZoom(const RenderSettings& settings,
+                      const std::vector<Tile>& tiles);
+  // Renders the tile_width x tile_height pixels from frame pixel (x0, y0),
+  // which may lie outside the frame, into `out`, rows `stride` apart.
+  template <typename T>
+  void RenderTile2D(const RenderSettings& settings, const PlaneView<T>& view,
+                    int32_t x0, int32_t y0, uint32_t tile_width,
+                    uint32_t tile_height, Color* out, uint32_t stride);
+  // Fills `regions` of buffer_ from the lattice tiles of `level_id` over
+  // them, rendering and caching the missing ones. Frame pixel (0, 0) is
+  // lattice pixel (lattice_x, lattice_y).
+  template <typename T>
+  void RenderCachedTiles(const RenderSettings& settings,
+                         const PlaneView<T>& view,
+                         const std::vector<Tile>& regions, uint32_t level_id,
+                         int64_t lattice_x, int64_t lattice_y);
+  // Instantiated per 3D fractal type, so the cone march and the normals
+  // inline its SDF.
+  template <FractalType kType>
+  void RenderTile3D(const RenderSettings& settings, const float* start_t,
+                    const Tile& tile);
+  // Adds extra samples to the edge pixels of the 2D frame in iterations_.
+  template <typename T>
+  void Antialias2D(const RenderSettings& settings, const PlaneView<T>& view);
+  // Adds extra samples to the edge pixels of the 3D frame in edge_samples_.
+  template <FractalType kType>
+  void Antialias3D(const RenderSettings& settings);
+  // Fills start_t_ from depth_, seen from depth_camera_, for `camera`.
+  void ReprojectDepth(const CameraSettings& camera);
+  // Moves buffer_ so pixel (x, y) takes the color of (x + dx, y + dy).
+  // Pixels that had no source keep stale colors.
+  void ShiftBuffer(int32_t dx, int32_t dy);
+  // Summarizes cost_ and replaces the frame's colors by its heatmap.
+  void FinishHeatmap();
+  // Appends tiles covering `region` to `tiles`.
+  void AppendTiles(const Tile& region, std::vector<Tile>* tiles) const;
+  // Index in the whole frame of buffer pixel `pixel`, which seeds its
+  // anti-aliasing samples the same in every crop.
+  uint32_t FramePixel(uint32_t pixel) const;
+
+  uint32_t TileCount() const;
+  Tile GetTile(uint32_t index) const;
 
   uint32_t width_ = 0;
   uint32_t height_ = 0;
+  // The frame the buffer is a crop of, and the crop's top left pixel in it.
+  // Pixels are mapped to the plane and to rays as pixels of the frame.
+  uint32_t frame_width_ = 0;
+  uint32_t frame_height_ = 0;
+  uint32_t crop_x_ = 0;
+  uint32_t crop_y_ = 0;
 
   SettingsProvider* settings_ = nullptr;
 
-  uint32_t target_ = 0;
   std::vector<Color> buffer_;
+  // Where the frame being rendered goes: buffer_ or RenderFrame's output.
+  Color* output_ = nullptr;
+  // Escape counts of the 2D frame, kept by the deep-zoom path, which colors
+  // after glitch fixing, and for anti-aliasing.
+  std::vector<int> iterations_;
+
+  uint32_t tile_size_ = 32;
+  const EscapeTimeKernels* kernels_ = nullptr;
+  PacketMarcher march_ = nullptr;
+  NormalMethod normals_ = NormalMethod::kCentral;
+  Subdivision2D subdivision_ = Subdivision2D::kOff;
+  std::atomic<uint32_t> subdivision_errors_ = 0;
+  uint32_t antialias_ = 0;
+  std::atomic<uint32_t> antialiased_pixels_ = 0;
+  bool cone_prepass_ = false;
+  // Per pixel of 3D frames with anti-aliasing.
+  std::vector<EdgeSample> edge_samples_;
+  ThreadPool pool_;
+
+  // How far each ray of the last 3D frame marched through empty space before
+  // it hit; 0 for rays that escaped or ran out of steps. It is only reused
+  // while depth_valid_ and the surface is unchanged.
+  bool reuse_depth_ = false;
+  bool depth_valid_ = false;
+  CameraSettings depth_camera_;
+  FractalSettings depth_fractal_;
+  std::vector<float> depth_;
+  // Reprojection scratch: nearest reprojected depth per pixel as float bits,
+  // and the resulting per-ray start distances.
+  std::vector<uint32_t> reprojected_;
+  std::vector<float> start_t_;
+
+  // Settings of the 2D frame in buffer_, valid while pan_valid_.
+  bool incremental_pan_ = true;
+  bool pan_valid_ = false;
+  RenderSettings pan_settings_;
+  std::vector<Color> pan_scratch_;
+
+  TileCache tile_cache_;
+
+  // Heatmap of the frame being rendered, and its per-pixel costs.
+  Heatmap heatmap_ = Heatmap::kOff;
+  std::vector<uint32_t> cost_;
+  CostStats cost_stats_;
 };
 
 }  // namespace render
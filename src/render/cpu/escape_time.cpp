@@ -0,0 +1,137 @@
+#include "render/cpu/escape_time.h"
+
+#include "render/common/fractals.h"
+
+namespace render {
+
+namespace scalar {
+
+void MandelbrotPoints(const float* xs, const float* ys, uint32_t count,
+                      int max_iter, int* out) {
+  for (uint32_t i = 0; i < count; ++i) {
+    out[i] = MandelbrotIterations(xs[i], ys[i], max_iter);
+  }
+}
+
+void JuliaPoints(const float* xs, const float* ys, uint32_t count,
+                 int max_iter, float c_re, float c_im, int* out) {
+  for (uint32_t i = 0; i < count; ++i) {
+    out[i] = JuliaIterations(xs[i], ys[i], max_iter, c_re, c_im);
+  }
+}
+
+void MandelbrotPointsDouble(const double* xs, const double* ys,
+                            uint32_t count, int max_iter, int* out) {
+  for (uint32_t i = 0; i < count; ++i) {
+    out[i] = MandelbrotIterations(xs[i], ys[i], max_iter);
+  }
+}
+
+void JuliaPointsDouble(const double* xs, const double* ys, uint32_t count,
+                       int max_iter, double c_re, double c_im, int* out) {
+  for (uint32_t i = 0; i < count; ++i) {
+    out[i] = JuliaIterations(xs[i], ys[i], max_iter, c_re, c_im);
+  }
+}
+
+void PerturbedPoints(const double* ref_re, const double* ref_im,
+                     int ref_length, const double* dc_re, const double* dc_im,
+                     uint32_t count, int max_iter, int* out,
+                     uint8_t* glitched) {
+  // Lockstep blocks give the out-of-order core independent chains to hide
+  // the latency of the delta recurrence.
+  constexpr uint32_t kLanes = 8;
+
+  for (uint32_t base = 0; base < count; base += kLanes) {
+    const uint32_t lanes = count - base < kLanes ? count - base : kLanes;
+
+    double cr[kLanes] = {};
+    double ci[kLanes] = {};
+    double dz_re[kLanes] = {};
+    double dz_im[kLanes] = {};
+    int active[kLanes] = {};
+    int glitch[kLanes] = {};
+    int iterations[kLanes] = {};
+    for (uint32_t l = 0; l < lanes; ++l) {
+      cr[l] = dc_re[base + l];
+      ci[l] = dc_im[base + l];
+      active[l] = 1;
+    }
+
+    for (int i = 0; i < max_iter; ++i) {
+      if (i >= ref_length) {
+        // The reference escaped before these points did.
+        for (uint32_t l = 0; l < kLanes; ++l) {
+          glitch[l] |= active[l];
+        }
+        break;
+      }
+
+      const double zr = ref_re[i];
+      const double zi = ref_im[i];
+      const double limit = kPerturbationGlitchTolerance * (zr * zr + zi * zi);
+
+      int any_active = 0;
+      for (uint32_t l = 0; l < kLanes; ++l) {
+        const double x = zr + dz_re[l];
+        const double y = zi + dz_im[l];
+        const double magnitude = x * x + y * y;
+        const int escaped = magnitude > 4.0;
+        const int lost = magnitude < limit;
+
+        glitch[l] |= active[l] & lost;
+        active[l] &= !(escaped | lost);
+        iterations[l] += active[l];
+        any_active |= active[l];
+
+        // Stopped lanes keep their delta so they cannot overflow.
+        const double tr = 2.0 * zr + dz_re[l];
+        const double ti = 2.0 * zi + dz_im[l];
+        const double next_re = tr * dz_re[l] - ti * dz_im[l] + cr[l];
+        const double next_im = tr * dz_im[l] + ti * dz_re[l] + ci[l];
+        dz_re[l] = active[l] ? next_re : dz_re[l];
+        dz_im[l] = active[l] ? next_im : dz_im[l];
+      }
+      if (!any_active) {
+        break;
+      }
+    }
+
+    for (uint32_t l = 0; l < lanes; ++l) {
+      out[base + l] = iterations[l];
+      glitched[base + l] = static_cast<uint8_t>(glitch[l]);
+    }
+  }
+}
+
+}  // namespace scalar
+
+const EscapeTimeKernels& GetEscapeTimeKernels(SimdLevel level) {
+  static const EscapeTimeKernels kScalar{
+      scalar::MandelbrotPoints, scalar::JuliaPoints,
+      scalar::MandelbrotPointsDouble, scalar::JuliaPointsDouble,
+      scalar::PerturbedPoints};
+#ifdef RENDER_X86_SIMD
+  static const EscapeTimeKernels kAVX2{
+      avx2::MandelbrotPoints, avx2::JuliaPoints,
+      avx2::MandelbrotPointsDouble, avx2::JuliaPointsDouble,
+      avx2::PerturbedPoints};
+  static const EscapeTimeKernels kAVX512{
+      avx512::MandelbrotPoints, avx512::JuliaPoints,
+      avx512::MandelbrotPointsDouble, avx512::JuliaPointsDouble,
+      avx512::PerturbedPoints};
+
+  switch (level) {
+    case SimdLevel::kAVX512:
+      return kAVX512;
+    case SimdLevel::kAVX2:
+      return kAVX2;
+    default:
+      return kScalar;
+  }
+#else
+  return kScalar;
+#endif
+}
+
+}  // namespace render
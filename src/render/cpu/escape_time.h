@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+
+#include "render/cpu/cpu_features.h"
+
+namespace render {
+
+// Escape-time kernels that iterate a batch of points at once, such as a row
+// segment or the border of a rectangle. Point i is (xs[i], ys[i]); its
+// iteration count is written to out[i] and matches MandelbrotIterations /
+// JuliaIterations for the same point. The *_double variants iterate in
+// double for mid-depth zooms.
+//
+// `perturbed` is the deep-zoom variant: point i is c = C + (dc_re[i],
+// dc_im[i]) for a reference C whose orbit Z_0..Z_{ref_length-1} is given in
+// double (see perturbation.h). Only the delta dz_{n+1} = (2 Z_n + dz_n) dz_n
+// + dc is iterated, in double. glitched[i] is set to 1 when the delta lost
+// precision against the reference or outlived it, and out[i] must then be
+// recomputed against another reference.
+struct EscapeTimeKernels {
+  void (*mandelbrot)(const float* xs, const float* ys, uint32_t count,
+                     int max_iter, int* out);
+  void (*julia)(const float* xs, const float* ys, uint32_t count,
+                int max_iter, float c_re, float c_im, int* out);
+  void (*mandelbrot_double)(const double* xs, const double* ys,
+                            uint32_t count, int max_iter, int* out);
+  void (*julia_double)(const double* xs, const double* ys, uint32_t count,
+                       int max_iter, double c_re, double c_im, int* out);
+  void (*perturbed)(const double* ref_re, const double* ref_im,
+                    int ref_length, const double* dc_re, const double* dc_im,
+                    uint32_t count, int max_iter, int* out, uint8_t* glitched);
+};
+
+// |Z_n + dz_n|^2 below this fraction of |Z_n|^2 means the pixel orbit came
+// much closer to zero than the reference and the delta is mostly rounding
+// noise (Pauldelbrot's criterion, 1e-3 on magnitudes).
+constexpr double kPerturbationGlitchTolerance = 1e-6;
+
+// Kernels for `level`, falling back to narrower ones the build lacks.
+const EscapeTimeKernels& GetEscapeTimeKernels(SimdLevel level);
+
+namespace scalar {
+
+void MandelbrotPoints(const float* xs, const float* ys, uint32_t count,
+                      int max_iter, int* out);
+void JuliaPoints(const float* xs, const float* ys, uint32_t count,
+                 int max_iter, float c_re, float c_im, int* out);
+void MandelbrotPointsDouble(const double* xs, const double* ys,
+                            uint32_t count, int max_iter, int* out);
+void JuliaPointsDouble(const double* xs, const double* ys, uint32_t count,
+                       int max_iter, double c_re, double c_im, int* out);
+void PerturbedPoints(const double* ref_re, const double* ref_im,
+                     int ref_length, const double* dc_re, const double* dc_im,
+                     uint32_t count, int max_iter, int* out,
+                     uint8_t* glitched);
+
+}  // namespace scalar
+
+#ifdef RENDER_X86_SIMD
+namespace avx2 {
+
+void MandelbrotPoints(const float* xs, const float* ys, uint32_t count,
+                      int max_iter, int* out);
+void JuliaPoints(const float* xs, const float* ys, uint32_t count,
+                 int max_iter, float c_re, float c_im, int* out);
+void MandelbrotPointsDouble(const double* xs, const double* ys,
+                            uint32_t count, int max_iter, int* out);
+void JuliaPointsDouble(const double* xs, const double* ys, uint32_t count,
+                       int max_iter, double c_re, double c_im, int* out);
+void PerturbedPoints(const double* ref_re, const double* ref_im,
+                     int ref_length, const double* dc_re, const double* dc_im,
+                     uint32_t count, int max_iter, int* out,
+                     uint8_t* glitched);
+
+}  // namespace avx2
+
+namespace avx512 {
+
+void MandelbrotPoints(const float* xs, const float* ys, uint32_t count,
+                      int max_iter, int* out);
+void JuliaPoints(const float* xs, const float* ys, uint32_t count,
+                 int max_iter, float c_re, float c_im, int* out);
+void MandelbrotPointsDouble(const double* xs, const double* ys,
+                            uint32_t count, int max_iter, int* out);
+void JuliaPointsDouble(const double* xs, const double* ys, uint32_t count,
+                       int max_iter, double c_re, double c_im, int* out);
+void PerturbedPoints(const double* ref_re, const double* ref_im,
+                     int ref_length, const double* dc_re, const double* dc_im,
+                     uint32_t count, int max_iter, int* out,
+                     uint8_t* glitched);
+
+}  // namespace avx512
+#endif
+
+}  // namespace render
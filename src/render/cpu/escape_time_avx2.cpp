@@ -0,0 +1,334 @@
+#include <immintrin.h>
+
+#include "render/cpu/escape_time.h"
+
+namespace render::avx2 {
+
+namespace {
+
+constexpr uint32_t kLanes = 8;
+
+// Iterates z = z^2 + c for 8 lanes until every lane escaped, hit
+// `max_iter` or settled. Escaped lanes keep iterating but stop counting.
+// Settled lanes, given in `settled` or found periodic like in
+// OrbitIterations, count `max_iter`.
+inline __m256i Iterate(__m256 zr, __m256 zi, __m256 cr, __m256 ci,
+                       __m256 settled, int max_iter) {
+  const __m256 four = _mm256_set1_ps(4.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256i one = _mm256_set1_epi32(1);
+
+  __m256i counts = _mm256_setzero_si256();
+  __m256 active =
+      _mm256_andnot_ps(settled, _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+  __m256 saved_r = zr;
+  __m256 saved_i = zi;
+  int next_save = 1;
+
+  for (int i = 0; i < max_iter; ++i) {
+    const __m256 zr2 = _mm256_mul_ps(zr, zr);
+    const __m256 zi2 = _mm256_mul_ps(zi, zi);
+    active = _mm256_and_ps(
+        active, _mm256_cmp_ps(_mm256_add_ps(zr2, zi2), four, _CMP_LE_OQ));
+    if (_mm256_movemask_ps(active) == 0) {
+      break;
+    }
+    counts = _mm256_add_epi32(
+        counts, _mm256_and_si256(_mm256_castps_si256(active), one));
+
+    zi = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(two, zr), zi), ci);
+    zr = _mm256_add_ps(_mm256_sub_ps(zr2, zi2), cr);
+
+    const __m256 same =
+        _mm256_and_ps(_mm256_cmp_ps(zr, saved_r, _CMP_EQ_OQ),
+                      _mm256_cmp_ps(zi, saved_i, _CMP_EQ_OQ));
+    const __m256 cycled = _mm256_and_ps(active, same);
+    settled = _mm256_or_ps(settled, cycled);
+    active = _mm256_andnot_ps(cycled, active);
+    if (i + 1 == next_save) {
+      saved_r = zr;
+      saved_i = zi;
+      next_save *= 2;
+    }
+  }
+  return _mm256_blendv_epi8(counts, _mm256_set1_epi32(max_iter),
+                            _mm256_castps_si256(settled));
+}
+
+// InMandelbrotBulbs for 8 lanes, as a lane mask.
+inline __m256 InBulbs(__m256 x, __m256 y) {
+  const __m256 xq = _mm256_sub_ps(x, _mm256_set1_ps(0.25f));
+  const __m256 y2 = _mm256_mul_ps(y, y);
+  const __m256 q = _mm256_add_ps(_mm256_mul_ps(xq, xq), y2);
+  const __m256 xb = _mm256_add_ps(x, _mm256_set1_ps(1.0f));
+  const __m256 cardioid =
+      _mm256_cmp_ps(_mm256_mul_ps(q, _mm256_add_ps(q, xq)),
+                    _mm256_mul_ps(_mm256_set1_ps(0.25f), y2), _CMP_LE_OQ);
+  const __m256 bulb =
+      _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(xb, xb), y2),
+                    _mm256_set1_ps(0.0625f), _CMP_LE_OQ);
+  return _mm256_or_ps(cardioid, bulb);
+}
+
+// Runs `kernel` over full 8-lane blocks and pads the tail block with the last
+// point, storing only the real lanes. Plain loops instead of <algorithm>: an
+// inline std:: template instantiated here would be built with AVX2 and could
+// be picked by the linker for the scalar code too.
+template <typename Kernel>
+void ForEachBlock(const float* xs, const float* ys, uint32_t count, int* out,
+                  Kernel kernel) {
+  uint32_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    const __m256i counts =
+        kernel(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), counts);
+  }
+  if (i == count) {
+    return;
+  }
+
+  alignas(32) float tail_xs[kLanes];
+  alignas(32) float tail_ys[kLanes];
+  alignas(32) int tail_out[kLanes];
+  for (uint32_t lane = 0; lane < kLanes; ++lane) {
+    const uint32_t index = i + lane < count ? i + lane : count - 1;
+    tail_xs[lane] = xs[index];
+    tail_ys[lane] = ys[index];
+  }
+  _mm256_store_si256(
+      reinterpret_cast<__m256i*>(tail_out),
+      kernel(_mm256_load_ps(tail_xs), _mm256_load_ps(tail_ys)));
+  for (uint32_t lane = 0; i + lane < count; ++lane) {
+    out[i + lane] = tail_out[lane];
+  }
+}
+
+constexpr uint32_t kDoubleLanes = 4;
+
+// Double-precision Iterate, four lanes.
+inline __m128i IterateDouble(__m256d zr, __m256d zi, __m256d cr, __m256d ci,
+                             __m256d settled, int max_iter) {
+  const __m256d four = _mm256_set1_pd(4.0);
+  const __m256d two = _mm256_set1_pd(2.0);
+  const __m256d one = _mm256_set1_pd(1.0);
+
+  __m256d counts = _mm256_setzero_pd();
+  __m256d active =
+      _mm256_andnot_pd(settled, _mm256_castsi256_pd(_mm256_set1_epi32(-1)));
+  __m256d saved_r = zr;
+  __m256d saved_i = zi;
+  int next_save = 1;
+
+  for (int i = 0; i < max_iter; ++i) {
+    const __m256d zr2 = _mm256_mul_pd(zr, zr);
+    const __m256d zi2 = _mm256_mul_pd(zi, zi);
+    active = _mm256_and_pd(
+        active, _mm256_cmp_pd(_mm256_add_pd(zr2, zi2), four, _CMP_LE_OQ));
+    if (_mm256_movemask_pd(active) == 0) {
+      break;
+    }
+    counts = _mm256_add_pd(counts, _mm256_and_pd(active, one));
+
+    zi = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, zr), zi), ci);
+    zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+
+    const __m256d same =
+        _mm256_and_pd(_mm256_cmp_pd(zr, saved_r, _CMP_EQ_OQ),
+                      _mm256_cmp_pd(zi, saved_i, _CMP_EQ_OQ));
+    const __m256d cycled = _mm256_and_pd(active, same);
+    settled = _mm256_or_pd(settled, cycled);
+    active = _mm256_andnot_pd(cycled, active);
+    if (i + 1 == next_save) {
+      saved_r = zr;
+      saved_i = zi;
+      next_save *= 2;
+    }
+  }
+  counts = _mm256_blendv_pd(counts, _mm256_set1_pd(max_iter), settled);
+  return _mm256_cvtpd_epi32(counts);
+}
+
+// InMandelbrotBulbs for 4 double lanes, as a lane mask.
+inline __m256d InBulbsDouble(__m256d x, __m256d y) {
+  const __m256d xq = _mm256_sub_pd(x, _mm256_set1_pd(0.25));
+  const __m256d y2 = _mm256_mul_pd(y, y);
+  const __m256d q = _mm256_add_pd(_mm256_mul_pd(xq, xq), y2);
+  const __m256d xb = _mm256_add_pd(x, _mm256_set1_pd(1.0));
+  const __m256d cardioid =
+      _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, xq)),
+                    _mm256_mul_pd(_mm256_set1_pd(0.25), y2), _CMP_LE_OQ);
+  const __m256d bulb =
+      _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(xb, xb), y2),
+                    _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+  return _mm256_or_pd(cardioid, bulb);
+}
+
+// ForEachBlock for double points.
+template <typename Kernel>
+void ForEachDoubleBlock(const double* xs, const double* ys, uint32_t count,
+                        int* out, Kernel kernel) {
+  uint32_t i = 0;
+  for (; i + kDoubleLanes <= count; i += kDoubleLanes) {
+    const __m128i counts =
+        kernel(_mm256_loadu_pd(xs + i), _mm256_loadu_pd(ys + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), counts);
+  }
+  if (i == count) {
+    return;
+  }
+
+  alignas(32) double tail_xs[kDoubleLanes];
+  alignas(32) double tail_ys[kDoubleLanes];
+  alignas(16) int tail_out[kDoubleLanes];
+  for (uint32_t lane = 0; lane < kDoubleLanes; ++lane) {
+    const uint32_t index = i + lane < count ? i + lane : count - 1;
+    tail_xs[lane] = xs[index];
+    tail_ys[lane] = ys[index];
+  }
+  _mm_store_si128(reinterpret_cast<__m128i*>(tail_out),
+                  kernel(_mm256_load_pd(tail_xs), _mm256_load_pd(tail_ys)));
+  for (uint32_t lane = 0; i + lane < count; ++lane) {
+    out[i + lane] = tail_out[lane];
+  }
+}
+
+// The perturbed kernel iterates doubles, four per register; two registers
+// per block keep two independent chains in flight.
+constexpr uint32_t kPerturbedVectors = 2;
+constexpr uint32_t kPerturbedLanes = 4 * kPerturbedVectors;
+
+}  // namespace
+
+void MandelbrotPoints(const float* xs, const float* ys, uint32_t count,
+                      int max_iter, int* out) {
+  ForEachBlock(xs, ys, count, out, [&](__m256 cr, __m256 ci) {
+    return Iterate(_mm256_setzero_ps(), _mm256_setzero_ps(), cr, ci,
+                   InBulbs(cr, ci), max_iter);
+  });
+}
+
+void JuliaPoints(const float* xs, const float* ys, uint32_t count,
+                 int max_iter, float c_re, float c_im, int* out) {
+  const __m256 cr = _mm256_set1_ps(c_re);
+  const __m256 ci = _mm256_set1_ps(c_im);
+  ForEachBlock(xs, ys, count, out, [&](__m256 zr, __m256 zi) {
+    return Iterate(zr, zi, cr, ci, _mm256_setzero_ps(), max_iter);
+  });
+}
+
+void MandelbrotPointsDouble(const double* xs, const double* ys,
+                            uint32_t count, int max_iter, int* out) {
+  ForEachDoubleBlock(xs, ys, count, out, [&](__m256d cr, __m256d ci) {
+    return IterateDouble(_mm256_setzero_pd(), _mm256_setzero_pd(), cr, ci,
+                         InBulbsDouble(cr, ci), max_iter);
+  });
+}
+
+void JuliaPointsDouble(const double* xs, const double* ys, uint32_t count,
+                       int max_iter, double c_re, double c_im, int* out) {
+  const __m256d cr = _mm256_set1_pd(c_re);
+  const __m256d ci = _mm256_set1_pd(c_im);
+  ForEachDoubleBlock(xs, ys, count, out, [&](__m256d zr, __m256d zi) {
+    return IterateDouble(zr, zi, cr, ci, _mm256_setzero_pd(), max_iter);
+  });
+}
+
+void PerturbedPoints(const double* ref_re, const double* ref_im,
+                     int ref_length, const double* dc_re, const double* dc_im,
+                     uint32_t count, int max_iter, int* out,
+                     uint8_t* glitched) {
+  const __m256d four = _mm256_set1_pd(4.0);
+  const __m256d one = _mm256_set1_pd(1.0);
+
+  for (uint32_t base = 0; base < count; base += kPerturbedLanes) {
+    // Staged through arrays, with the tail padded by the last point.
+    alignas(32) double block_re[kPerturbedLanes];
+    alignas(32) double block_im[kPerturbedLanes];
+    for (uint32_t lane = 0; lane < kPerturbedLanes; ++lane) {
+      const uint32_t index = base + lane < count ? base + lane : count - 1;
+      block_re[lane] = dc_re[index];
+      block_im[lane] = dc_im[index];
+    }
+
+    __m256d cr[kPerturbedVectors];
+    __m256d ci[kPerturbedVectors];
+    __m256d dz_re[kPerturbedVectors];
+    __m256d dz_im[kPerturbedVectors];
+    __m256d counts[kPerturbedVectors];
+    __m256d active[kPerturbedVectors];
+    __m256d glitch[kPerturbedVectors];
+    for (uint32_t v = 0; v < kPerturbedVectors; ++v) {
+      cr[v] = _mm256_load_pd(block_re + 4 * v);
+      ci[v] = _mm256_load_pd(block_im + 4 * v);
+      dz_re[v] = _mm256_setzero_pd();
+      dz_im[v] = _mm256_setzero_pd();
+      counts[v] = _mm256_setzero_pd();
+      active[v] = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+      glitch[v] = _mm256_setzero_pd();
+    }
+
+    for (int i = 0; i < max_iter; ++i) {
+      if (i >= ref_length) {
+        // The reference escaped before these points did.
+        for (uint32_t v = 0; v < kPerturbedVectors; ++v) {
+          glitch[v] = _mm256_or_pd(glitch[v], active[v]);
+        }
+        break;
+      }
+
+      const double ref_zr = ref_re[i];
+      const double ref_zi = ref_im[i];
+      const __m256d zr = _mm256_set1_pd(ref_zr);
+      const __m256d zi = _mm256_set1_pd(ref_zi);
+      const __m256d two_zr = _mm256_set1_pd(2.0 * ref_zr);
+      const __m256d two_zi = _mm256_set1_pd(2.0 * ref_zi);
+      const __m256d limit = _mm256_set1_pd(
+          kPerturbationGlitchTolerance * (ref_zr * ref_zr + ref_zi * ref_zi));
+
+      int any_active = 0;
+      for (uint32_t v = 0; v < kPerturbedVectors; ++v) {
+        const __m256d x = _mm256_add_pd(zr, dz_re[v]);
+        const __m256d y = _mm256_add_pd(zi, dz_im[v]);
+        const __m256d magnitude =
+            _mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y));
+        const __m256d escaped = _mm256_cmp_pd(magnitude, four, _CMP_GT_OQ);
+        const __m256d lost = _mm256_cmp_pd(magnitude, limit, _CMP_LT_OQ);
+
+        glitch[v] = _mm256_or_pd(glitch[v], _mm256_and_pd(active[v], lost));
+        active[v] = _mm256_andnot_pd(_mm256_or_pd(escaped, lost), active[v]);
+        counts[v] = _mm256_add_pd(counts[v], _mm256_and_pd(active[v], one));
+        any_active |= _mm256_movemask_pd(active[v]);
+
+        const __m256d tr = _mm256_add_pd(two_zr, dz_re[v]);
+        const __m256d ti = _mm256_add_pd(two_zi, dz_im[v]);
+        const __m256d next_re = _mm256_add_pd(
+            _mm256_sub_pd(_mm256_mul_pd(tr, dz_re[v]),
+                          _mm256_mul_pd(ti, dz_im[v])),
+            cr[v]);
+        const __m256d next_im = _mm256_add_pd(
+            _mm256_add_pd(_mm256_mul_pd(tr, dz_im[v]),
+                          _mm256_mul_pd(ti, dz_re[v])),
+            ci[v]);
+        dz_re[v] = _mm256_blendv_pd(dz_re[v], next_re, active[v]);
+        dz_im[v] = _mm256_blendv_pd(dz_im[v], next_im, active[v]);
+      }
+      if (any_active == 0) {
+        break;
+      }
+    }
+
+    alignas(32) double block_counts[kPerturbedLanes];
+    alignas(32) double block_glitch[kPerturbedLanes];
+    for (uint32_t v = 0; v < kPerturbedVectors; ++v) {
+      _mm256_store_pd(block_counts + 4 * v, counts[v]);
+      _mm256_store_pd(block_glitch + 4 * v, glitch[v]);
+    }
+    for (uint32_t lane = 0; lane < kPerturbedLanes && base + lane < count;
+         ++lane) {
+      out[base + lane] = static_cast<int>(block_counts[lane]);
+      glitched[base + lane] = block_glitch[lane] != 0.0 ? 1 : 0;
+    }
+  }
+}
+
+}  // namespace render::avx2
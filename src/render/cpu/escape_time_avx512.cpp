@@ -0,0 +1,315 @@
+#include <immintrin.h>
+
+#include "render/cpu/escape_time.h"
+
+namespace render::avx512 {
+
+namespace {
+
+constexpr uint32_t kLanes = 16;
+
+// Iterates z = z^2 + c for 16 lanes until every lane escaped, hit
+// `max_iter` or settled. Escaped lanes keep iterating but stop counting.
+// Settled lanes, given in `settled` or found periodic like in
+// OrbitIterations, count `max_iter`.
+inline __m512i Iterate(__m512 zr, __m512 zi, __m512 cr, __m512 ci,
+                       __mmask16 settled, int max_iter) {
+  const __m512 four = _mm512_set1_ps(4.0f);
+  const __m512 two = _mm512_set1_ps(2.0f);
+  const __m512i one = _mm512_set1_epi32(1);
+
+  __m512i counts = _mm512_setzero_si512();
+  __mmask16 active = static_cast<__mmask16>(~settled);
+  __m512 saved_r = zr;
+  __m512 saved_i = zi;
+  int next_save = 1;
+
+  for (int i = 0; i < max_iter; ++i) {
+    const __m512 zr2 = _mm512_mul_ps(zr, zr);
+    const __m512 zi2 = _mm512_mul_ps(zi, zi);
+    active = _mm512_mask_cmp_ps_mask(active, _mm512_add_ps(zr2, zi2), four,
+                                     _CMP_LE_OQ);
+    if (active == 0) {
+      break;
+    }
+    counts = _mm512_mask_add_epi32(counts, active, counts, one);
+
+    zi = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(two, zr), zi), ci);
+    zr = _mm512_add_ps(_mm512_sub_ps(zr2, zi2), cr);
+
+    const __mmask16 cycled = _mm512_mask_cmp_ps_mask(
+        _mm512_mask_cmp_ps_mask(active, zr, saved_r, _CMP_EQ_OQ), zi, saved_i,
+        _CMP_EQ_OQ);
+    settled |= cycled;
+    active &= static_cast<__mmask16>(~cycled);
+    if (i + 1 == next_save) {
+      saved_r = zr;
+      saved_i = zi;
+      next_save *= 2;
+    }
+  }
+  return _mm512_mask_mov_epi32(counts, settled, _mm512_set1_epi32(max_iter));
+}
+
+// InMandelbrotBulbs for 16 lanes, as a lane mask.
+inline __mmask16 InBulbs(__m512 x, __m512 y) {
+  const __m512 xq = _mm512_sub_ps(x, _mm512_set1_ps(0.25f));
+  const __m512 y2 = _mm512_mul_ps(y, y);
+  const __m512 q = _mm512_add_ps(_mm512_mul_ps(xq, xq), y2);
+  const __m512 xb = _mm512_add_ps(x, _mm512_set1_ps(1.0f));
+  const __mmask16 cardioid =
+      _mm512_cmp_ps_mask(_mm512_mul_ps(q, _mm512_add_ps(q, xq)),
+                         _mm512_mul_ps(_mm512_set1_ps(0.25f), y2), _CMP_LE_OQ);
+  const __mmask16 bulb =
+      _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_mul_ps(xb, xb), y2),
+                         _mm512_set1_ps(0.0625f), _CMP_LE_OQ);
+  return cardioid | bulb;
+}
+
+// Runs `kernel` over full 16-lane blocks; the tail block uses masked loads
+// and stores.
+template <typename Kernel>
+void ForEachBlock(const float* xs, const float* ys, uint32_t count, int* out,
+                  Kernel kernel) {
+  uint32_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    _mm512_storeu_si512(
+        out + i, kernel(_mm512_loadu_ps(xs + i), _mm512_loadu_ps(ys + i)));
+  }
+  if (i == count) {
+    return;
+  }
+
+  const __mmask16 tail = static_cast<__mmask16>((1u << (count - i)) - 1);
+  const __m512 tail_xs =
+      _mm512_mask_loadu_ps(_mm512_set1_ps(xs[count - 1]), tail, xs + i);
+  const __m512 tail_ys =
+      _mm512_mask_loadu_ps(_mm512_set1_ps(ys[count - 1]), tail, ys + i);
+  _mm512_mask_storeu_epi32(out + i, tail, kernel(tail_xs, tail_ys));
+}
+
+constexpr uint32_t kDoubleLanes = 8;
+
+// Double-precision Iterate, eight lanes.
+inline __m256i IterateDouble(__m512d zr, __m512d zi, __m512d cr, __m512d ci,
+                             __mmask8 settled, int max_iter) {
+  const __m512d four = _mm512_set1_pd(4.0);
+  const __m512d two = _mm512_set1_pd(2.0);
+  const __m512i one = _mm512_set1_epi64(1);
+
+  __m512i counts = _mm512_setzero_si512();
+  __mmask8 active = static_cast<__mmask8>(~settled);
+  __m512d saved_r = zr;
+  __m512d saved_i = zi;
+  int next_save = 1;
+
+  for (int i = 0; i < max_iter; ++i) {
+    const __m512d zr2 = _mm512_mul_pd(zr, zr);
+    const __m512d zi2 = _mm512_mul_pd(zi, zi);
+    active = _mm512_mask_cmp_pd_mask(active, _mm512_add_pd(zr2, zi2), four,
+                                     _CMP_LE_OQ);
+    if (active == 0) {
+      break;
+    }
+    counts = _mm512_mask_add_epi64(counts, active, counts, one);
+
+    zi = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, zr), zi), ci);
+    zr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+
+    const __mmask8 cycled = _mm512_mask_cmp_pd_mask(
+        _mm512_mask_cmp_pd_mask(active, zr, saved_r, _CMP_EQ_OQ), zi, saved_i,
+        _CMP_EQ_OQ);
+    settled |= cycled;
+    active &= static_cast<__mmask8>(~cycled);
+    if (i + 1 == next_save) {
+      saved_r = zr;
+      saved_i = zi;
+      next_save *= 2;
+    }
+  }
+  counts = _mm512_mask_mov_epi64(counts, settled, _mm512_set1_epi64(max_iter));
+  return _mm512_cvtepi64_epi32(counts);
+}
+
+// InMandelbrotBulbs for 8 double lanes, as a lane mask.
+inline __mmask8 InBulbsDouble(__m512d x, __m512d y) {
+  const __m512d xq = _mm512_sub_pd(x, _mm512_set1_pd(0.25));
+  const __m512d y2 = _mm512_mul_pd(y, y);
+  const __m512d q = _mm512_add_pd(_mm512_mul_pd(xq, xq), y2);
+  const __m512d xb = _mm512_add_pd(x, _mm512_set1_pd(1.0));
+  const __mmask8 cardioid =
+      _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, xq)),
+                         _mm512_mul_pd(_mm512_set1_pd(0.25), y2), _CMP_LE_OQ);
+  const __mmask8 bulb =
+      _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(xb, xb), y2),
+                         _mm512_set1_pd(0.0625), _CMP_LE_OQ);
+  return cardioid | bulb;
+}
+
+// ForEachBlock for double points. Masked 32-bit stores need AVX-512VL, so
+// the tail goes through a buffer.
+template <typename Kernel>
+void ForEachDoubleBlock(const double* xs, const double* ys, uint32_t count,
+                        int* out, Kernel kernel) {
+  uint32_t i = 0;
+  for (; i + kDoubleLanes <= count; i += kDoubleLanes) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(out + i),
+        kernel(_mm512_loadu_pd(xs + i), _mm512_loadu_pd(ys + i)));
+  }
+  if (i == count) {
+    return;
+  }
+
+  const __mmask8 tail = static_cast<__mmask8>((1u << (count - i)) - 1);
+  const __m512d tail_xs =
+      _mm512_mask_loadu_pd(_mm512_set1_pd(xs[count - 1]), tail, xs + i);
+  const __m512d tail_ys =
+      _mm512_mask_loadu_pd(_mm512_set1_pd(ys[count - 1]), tail, ys + i);
+  alignas(32) int tail_out[kDoubleLanes];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(tail_out),
+                     kernel(tail_xs, tail_ys));
+  for (uint32_t lane = 0; i + lane < count; ++lane) {
+    out[i + lane] = tail_out[lane];
+  }
+}
+
+// The perturbed kernel iterates doubles, eight per register; two registers
+// per block keep two independent chains in flight.
+constexpr uint32_t kPerturbedVectors = 2;
+constexpr uint32_t kPerturbedLanes = 8 * kPerturbedVectors;
+
+}  // namespace
+
+void MandelbrotPoints(const float* xs, const float* ys, uint32_t count,
+                      int max_iter, int* out) {
+  ForEachBlock(xs, ys, count, out, [&](__m512 cr, __m512 ci) {
+    return Iterate(_mm512_setzero_ps(), _mm512_setzero_ps(), cr, ci,
+                   InBulbs(cr, ci), max_iter);
+  });
+}
+
+void JuliaPoints(const float* xs, const float* ys, uint32_t count,
+                 int max_iter, float c_re, float c_im, int* out) {
+  const __m512 cr = _mm512_set1_ps(c_re);
+  const __m512 ci = _mm512_set1_ps(c_im);
+  ForEachBlock(xs, ys, count, out, [&](__m512 zr, __m512 zi) {
+    return Iterate(zr, zi, cr, ci, 0, max_iter);
+  });
+}
+
+void MandelbrotPointsDouble(const double* xs, const double* ys,
+                            uint32_t count, int max_iter, int* out) {
+  ForEachDoubleBlock(xs, ys, count, out, [&](__m512d cr, __m512d ci) {
+    return IterateDouble(_mm512_setzero_pd(), _mm512_setzero_pd(), cr, ci,
+                         InBulbsDouble(cr, ci), max_iter);
+  });
+}
+
+void JuliaPointsDouble(const double* xs, const double* ys, uint32_t count,
+                       int max_iter, double c_re, double c_im, int* out) {
+  const __m512d cr = _mm512_set1_pd(c_re);
+  const __m512d ci = _mm512_set1_pd(c_im);
+  ForEachDoubleBlock(xs, ys, count, out, [&](__m512d zr, __m512d zi) {
+    return IterateDouble(zr, zi, cr, ci, 0, max_iter);
+  });
+}
+
+void PerturbedPoints(const double* ref_re, const double* ref_im,
+                     int ref_length, const double* dc_re, const double* dc_im,
+                     uint32_t count, int max_iter, int* out,
+                     uint8_t* glitched) {
+  const __m512d four = _mm512_set1_pd(4.0);
+  const __m512i one = _mm512_set1_epi64(1);
+
+  for (uint32_t base = 0; base < count; base += kPerturbedLanes) {
+    // Staged through arrays, with the tail padded by the last point.
+    alignas(64) double block_re[kPerturbedLanes];
+    alignas(64) double block_im[kPerturbedLanes];
+    for (uint32_t lane = 0; lane < kPerturbedLanes; ++lane) {
+      const uint32_t index = base + lane < count ? base + lane : count - 1;
+      block_re[lane] = dc_re[index];
+      block_im[lane] = dc_im[index];
+    }
+
+    __m512d cr[kPerturbedVectors];
+    __m512d ci[kPerturbedVectors];
+    __m512d dz_re[kPerturbedVectors];
+    __m512d dz_im[kPerturbedVectors];
+    __m512i counts[kPerturbedVectors];
+    __mmask8 active[kPerturbedVectors];
+    __mmask8 glitch[kPerturbedVectors];
+    for (uint32_t v = 0; v < kPerturbedVectors; ++v) {
+      cr[v] = _mm512_load_pd(block_re + 8 * v);
+      ci[v] = _mm512_load_pd(block_im + 8 * v);
+      dz_re[v] = _mm512_setzero_pd();
+      dz_im[v] = _mm512_setzero_pd();
+      counts[v] = _mm512_setzero_si512();
+      active[v] = 0xff;
+      glitch[v] = 0;
+    }
+
+    for (int i = 0; i < max_iter; ++i) {
+      if (i >= ref_length) {
+        // The reference escaped before these points did.
+        for (uint32_t v = 0; v < kPerturbedVectors; ++v) {
+          glitch[v] |= active[v];
+        }
+        break;
+      }
+
+      const double ref_zr = ref_re[i];
+      const double ref_zi = ref_im[i];
+      const __m512d zr = _mm512_set1_pd(ref_zr);
+      const __m512d zi = _mm512_set1_pd(ref_zi);
+      const __m512d two_zr = _mm512_set1_pd(2.0 * ref_zr);
+      const __m512d two_zi = _mm512_set1_pd(2.0 * ref_zi);
+      const __m512d limit = _mm512_set1_pd(
+          kPerturbationGlitchTolerance * (ref_zr * ref_zr + ref_zi * ref_zi));
+
+      __mmask8 any_active = 0;
+      for (uint32_t v = 0; v < kPerturbedVectors; ++v) {
+        const __m512d x = _mm512_add_pd(zr, dz_re[v]);
+        const __m512d y = _mm512_add_pd(zi, dz_im[v]);
+        const __m512d magnitude =
+            _mm512_add_pd(_mm512_mul_pd(x, x), _mm512_mul_pd(y, y));
+        const __mmask8 escaped =
+            _mm512_cmp_pd_mask(magnitude, four, _CMP_GT_OQ);
+        const __mmask8 lost = _mm512_cmp_pd_mask(magnitude, limit, _CMP_LT_OQ);
+
+        glitch[v] |= active[v] & lost;
+        active[v] &= static_cast<__mmask8>(~(escaped | lost));
+        counts[v] = _mm512_mask_add_epi64(counts[v], active[v], counts[v], one);
+        any_active |= active[v];
+
+        const __m512d tr = _mm512_add_pd(two_zr, dz_re[v]);
+        const __m512d ti = _mm512_add_pd(two_zi, dz_im[v]);
+        const __m512d next_re = _mm512_add_pd(
+            _mm512_sub_pd(_mm512_mul_pd(tr, dz_re[v]),
+                          _mm512_mul_pd(ti, dz_im[v])),
+            cr[v]);
+        const __m512d next_im = _mm512_add_pd(
+            _mm512_add_pd(_mm512_mul_pd(tr, dz_im[v]),
+                          _mm512_mul_pd(ti, dz_re[v])),
+            ci[v]);
+        dz_re[v] = _mm512_mask_mov_pd(dz_re[v], active[v], next_re);
+        dz_im[v] = _mm512_mask_mov_pd(dz_im[v], active[v], next_im);
+      }
+      if (any_active == 0) {
+        break;
+      }
+    }
+
+    alignas(64) int64_t block_counts[kPerturbedLanes];
+    for (uint32_t v = 0; v < kPerturbedVectors; ++v) {
+      _mm512_store_si512(block_counts + 8 * v, counts[v]);
+    }
+    for (uint32_t lane = 0; lane < kPerturbedLanes && base + lane < count;
+         ++lane) {
+      out[base + lane] = static_cast<int>(block_counts[lane]);
+      glitched[base + lane] = (glitch[lane / 8] >> (lane % 8)) & 1;
+    }
+  }
+}
+
+}  // namespace render::avx512
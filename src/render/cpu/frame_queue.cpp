@@ -0,0 +1,46 @@
+#include "render/cpu/frame_queue.h"
+
+#include <utility>
+
+namespace render {
+
+FrameQueue::FrameQueue() {
+  for (uint32_t slot = 0; slot < kSlots; ++slot) {
+    frames_[slot].slot = slot;
+  }
+}
+
+Frame& FrameQueue::back() { return frames_[back_]; }
+
+void FrameQueue::Publish() {
+  std::lock_guard lock(mutex_);
+  if (fresh_) {
+    ++dropped_;
+  }
+  std::swap(back_, ready_);
+  fresh_ = true;
+}
+
+bool FrameQueue::ready() const {
+  std::lock_guard lock(mutex_);
+  return fresh_;
+}
+
+bool FrameQueue::Acquire() {
+  std::lock_guard lock(mutex_);
+  if (!fresh_) {
+    return false;
+  }
+  std::swap(front_, ready_);
+  fresh_ = false;
+  return true;
+}
+
+const Frame& FrameQueue::front() const { return frames_[front_]; }
+
+uint64_t FrameQueue::dropped() const {
+  std::lock_guard lock(mutex_);
+  return dropped_;
+}
+
+}  // namespace render
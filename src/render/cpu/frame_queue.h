@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "render/renderer.h"
+
+namespace render {
+
+// What a slot of a FrameQueue holds. The pixels live in storage the owner of
+// the queue keeps per slot, so they can be anywhere the consumer reads fast,
+// e.g. mapped GPU memory.
+struct Frame {
+  // Index of the slot's storage, in [0, FrameQueue::kSlots).
+  uint32_t slot = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  FrameStats stats;
+};
+
+// Triple buffer that hands finished frames from one producer thread to one
+// consumer thread. The producer always has a slot to render into and the
+// consumer always has the newest finished frame, so neither waits for the
+// other. A frame published while the previous one was not acquired yet
+// replaces it: stale frames are dropped, not queued.
+class FrameQueue {
+ public:
+  static constexpr uint32_t kSlots = 3;
+
+  FrameQueue();
+
+  FrameQueue(const FrameQueue&) = delete;
+  FrameQueue& operator=(const FrameQueue&) = delete;
+
+  // Producer: the slot to fill. Its previous contents are a frame that was
+  // dropped or already presented.
+  Frame& back();
+  // Producer: makes back() the newest frame and hands out another slot.
+  void Publish();
+
+  // Consumer: whether a frame was published since the last Acquire.
+  bool ready() const;
+  // Consumer: if a frame was published since the last call, makes it front()
+  // and returns true. The previous front() goes back to the producer.
+  bool Acquire();
+  // Consumer: the frame last acquired. It stays valid until the next Acquire.
+  const Frame& front() const;
+  // Consumer: calls `fn` with the ready and the front frame, the slots the
+  // producer does not hold, while Publish waits. Their storage may be
+  // replaced in `fn`.
+  template <typename Fn>
+  void ForConsumerFrames(Fn fn) {
+    std::lock_guard lock(mutex_);
+    fn(frames_[ready_]);
+    fn(frames_[front_]);
+  }
+
+  // Frames replaced before the consumer acquired them.
+  uint64_t dropped() const;
+
+ private:
+  mutable std::mutex mutex_;
+  Frame frames_[kSlots];
+  // Slot indices. Only the producer touches back_ and only the consumer
+  // front_ outside of swaps under mutex_.
+  uint32_t back_ = 0;
+  uint32_t ready_ = 1;
+  uint32_t front_ = 2;
+  // Whether ready_ holds a frame that was not acquired yet.
+  bool fresh_ = false;
+  uint64_t dropped_ = 0;
+};
+
+}  // namespace render
@@ -0,0 +1,281 @@
+#include "render/cpu/gl_cpu_renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "render/cpu/trace.h"
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace render {
+
+namespace {
+
+constexpr GLbitfield kStorageFlags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+// Fences are polled in steps of this many nanoseconds.
+constexpr GLuint64 kFenceTimeout = 1000000;
+
+}  // namespace
+
+GLCPURenderer::GLCPURenderer() : GLCPURenderer(CPURendererOptions{}) {}
+
+GLCPURenderer::GLCPURenderer(const CPURendererOptions& options)
+    : CPURenderer(options), thread_(&GLCPURenderer::RenderLoop, this) {}
+
+GLCPURenderer::~GLCPURenderer() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+
+  if (QOpenGLContext::currentContext()) {
+    for (uint32_t slot = 0; slot < FrameQueue::kSlots; ++slot) {
+      ReleaseSlot(slot);
+    }
+  }
+}
+
+void GLCPURenderer::Init(uint32_t target_tex_id) {
+  target_ = target_tex_id;
+
+  // Core since OpenGL 4.4; the app asks for 3.3, so look for the extension.
+  auto* context = QOpenGLContext::currentContext();
+  if (context && context->hasExtension("GL_ARB_buffer_storage")) {
+    buffer_storage_ = reinterpret_cast<BufferStorageFunction>(
+        context->getProcAddress("glBufferStorage"));
+  }
+}
+
+void GLCPURenderer::Resize(uint32_t w, uint32_t h) {
+  target_width_ = w;
+  target_height_ = h;
+  wanted_pixels_ = std::max(wanted_pixels_, static_cast<size_t>(w) * h);
+  ReplaceSmallSlots();
+
+  // The render thread resizes the CPU buffer before its next frame.
+  std::lock_guard lock(mutex_);
+  requested_width_ = w;
+  requested_height_ = h;
+}
+
+void GLCPURenderer::Render() {
+  if (target_ == 0 || !settings_provider()) {
+    return;
+  }
+
+  // Settings are read here, on the GL thread that also changes them.
+  TraceSpan span("settings");
+  const auto settings = settings_provider()->GetSettings();
+  {
+    std::lock_guard lock(mutex_);
+    requested_settings_ = settings;
+    requested_ = true;
+  }
+  wake_.notify_one();
+}
+
+bool GLCPURenderer::Present(FrameStats* stats) {
+  if (target_ == 0) {
+    return false;
+  }
+  // Slots the render thread held during a resize are grown once it let go.
+  ReplaceSmallSlots();
+  if (!frames_.ready()) {
+    return false;
+  }
+
+  // Acquire hands the frame shown so far back to the render thread, which
+  // must not write into it while the texture update still reads it.
+  WaitForUpload(frames_.front().slot);
+  frames_.Acquire();
+
+  // Frames rendered before a resize no longer fit the texture.
+  const Frame& frame = frames_.front();
+  if (frame.width != target_width_ || frame.height != target_height_) {
+    return false;
+  }
+
+  {
+    TraceSpan span("upload");
+    UploadFrame(frame);
+  }
+  *stats = frame.stats;
+  return true;
+}
+
+void GLCPURenderer::SetFrameReadyCallback(std::function<void()> callback) {
+  std::lock_guard lock(mutex_);
+  frame_ready_ = std::move(callback);
+}
+
+void GLCPURenderer::RenderLoop() {
+  Tracer::Get().SetThreadName("render");
+  while (true) {
+    RenderSettings settings;
+    uint32_t width;
+    uint32_t height;
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock, [this] { return stop_ || requested_; });
+      if (stop_) {
+        return;
+      }
+      settings = requested_settings_;
+      width = requested_width_;
+      height = requested_height_;
+      requested_ = false;
+    }
+
+    if (width != this->width() || height != this->height()) {
+      CPURenderer::Resize(width, height);
+    }
+    if (width == 0 || height == 0) {
+      continue;
+    }
+
+    // The back slot is this thread's until it is published. One it held
+    // while the window grew is too small: it is handed over empty for the
+    // GL thread to grow, and the request is rendered into the next slot.
+    Frame& frame = frames_.back();
+    if (static_cast<size_t>(width) * height > storage_pixels_[frame.slot]) {
+      frame.width = 0;
+      frame.height = 0;
+      frames_.Publish();
+      {
+        std::lock_guard lock(mutex_);
+        requested_ = true;
+      }
+      NotifyFrameReady();
+      continue;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    RenderFrame(settings, storage_[frame.slot]);
+    const auto end = std::chrono::steady_clock::now();
+
+    {
+      TraceSpan span("publish");
+      frame.width = width;
+      frame.height = height;
+      frame.stats.render_ms =
+          std::chrono::duration<double, std::milli>(end - start).count();
+      frame.stats.heatmap = settings.heatmap != Heatmap::kOff;
+      frame.stats.cost_p50 = frame.stats.heatmap ? cost_stats().p50 : 0;
+      frame.stats.cost_p99 = frame.stats.heatmap ? cost_stats().p99 : 0;
+      frames_.Publish();
+    }
+
+    NotifyFrameReady();
+  }
+}
+
+void GLCPURenderer::NotifyFrameReady() {
+  std::function<void()> frame_ready;
+  {
+    std::lock_guard lock(mutex_);
+    frame_ready = frame_ready_;
+  }
+  if (frame_ready) {
+    frame_ready();
+  }
+}
+
+void GLCPURenderer::ReplaceSmallSlots() {
+  frames_.ForConsumerFrames([this](Frame& frame) {
+    if (storage_pixels_[frame.slot] >= wanted_pixels_) {
+      return;
+    }
+    ReleaseSlot(frame.slot);
+    AllocateSlot(frame.slot, wanted_pixels_);
+    frame.width = 0;
+    frame.height = 0;
+  });
+}
+
+void GLCPURenderer::AllocateSlot(uint32_t slot, size_t pixels) {
+  if (buffer_storage_) {
+    auto* gl = QOpenGLContext::currentContext()->extraFunctions();
+    const GLsizeiptr bytes = pixels * sizeof(Color);
+    gl->glGenBuffers(1, &buffers_[slot]);
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[slot]);
+    buffer_storage_(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, kStorageFlags);
+    storage_[slot] = static_cast<Color*>(gl->glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, bytes, kStorageFlags));
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (storage_[slot]) {
+      storage_pixels_[slot] = pixels;
+      return;
+    }
+    // Fall back to CPU memory for good.
+    gl->glDeleteBuffers(1, &buffers_[slot]);
+    buffers_[slot] = 0;
+    buffer_storage_ = nullptr;
+  }
+
+  cpu_storage_[slot].resize(pixels);
+  storage_[slot] = cpu_storage_[slot].data();
+  storage_pixels_[slot] = pixels;
+}
+
+void GLCPURenderer::ReleaseSlot(uint32_t slot) {
+  WaitForUpload(slot);
+  storage_[slot] = nullptr;
+  storage_pixels_[slot] = 0;
+  cpu_storage_[slot] = {};
+
+  if (buffers_[slot] == 0) {
+    return;
+  }
+  auto* gl = QOpenGLContext::currentContext()->extraFunctions();
+  gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[slot]);
+  gl->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  gl->glDeleteBuffers(1, &buffers_[slot]);
+  buffers_[slot] = 0;
+}
+
+void GLCPURenderer::WaitForUpload(uint32_t slot) {
+  if (!fences_[slot]) {
+    return;
+  }
+
+  auto* gl = QOpenGLContext::currentContext()->extraFunctions();
+  while (gl->glClientWaitSync(fences_[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                              kFenceTimeout) == GL_TIMEOUT_EXPIRED) {
+  }
+  gl->glDeleteSync(fences_[slot]);
+  fences_[slot] = nullptr;
+}
+
+void GLCPURenderer::UploadFrame(const Frame& frame) {
+  auto* gl = QOpenGLContext::currentContext()->extraFunctions();
+
+  gl->glBindTexture(GL_TEXTURE_2D, target_);
+
+  gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  if (buffers_[frame.slot] != 0) {
+    // Sourced from the bound buffer, the update is queued and returns at
+    // once; the fence tells when the buffer may be written again.
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[frame.slot]);
+    gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width, frame.height,
+                        GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    fences_[frame.slot] = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  } else {
+    gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width, frame.height,
+                        GL_RGBA, GL_UNSIGNED_BYTE, storage_[frame.slot]);
+  }
+
+  gl->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+}  // namespace render
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "render/cpu/cpu_renderer.h"
+#include "render/cpu/frame_queue.h"
+
+namespace render {
+
+// CPURenderer for the app. Frames are rendered on a thread of its own and
+// handed over in a FrameQueue, so a slow frame never blocks the GL thread;
+// Present uploads the newest finished frame into an OpenGL texture.
+class GLCPURenderer : public CPURenderer {
+ public:
+  GLCPURenderer();
+  explicit GLCPURenderer(const CPURendererOptions& options);
+  ~GLCPURenderer();
+
+  void Init(uint32_t target_tex_id) override;
+  void Resize(uint32_t w, uint32_t h) override;
+  // Requests a frame with the current settings. A request the render thread
+  // did not start yet is replaced.
+  void Render() override;
+  bool Present(FrameStats* stats) override;
+  void SetFrameReadyCallback(std::function<void()> callback) override;
+
+ private:
+  using BufferStorageFunction = void(QOPENGLF_APIENTRYP)(GLenum, GLsizeiptr,
+                                                          const void*,
+                                                          GLbitfield);
+
+  void RenderLoop();
+  // Render thread: calls the frame ready callback, if any.
+  void NotifyFrameReady();
+  // GL thread: gives the slots the render thread does not hold at least
+  // wanted_pixels_ colors. Frames in replaced slots are dropped.
+  void ReplaceSmallSlots();
+  void AllocateSlot(uint32_t slot, size_t pixels);
+  void ReleaseSlot(uint32_t slot);
+  // GL thread: blocks until the texture update from `slot` is done.
+  void WaitForUpload(uint32_t slot);
+  void UploadFrame(const Frame& frame);
+
+  uint32_t target_ = 0;
+  // Size of the target texture, set on the GL thread.
+  uint32_t target_width_ = 0;
+  uint32_t target_height_ = 0;
+
+  FrameQueue frames_;
+
+  // Pixel storage of every FrameQueue slot. With GL_ARB_buffer_storage these
+  // are persistently mapped pixel buffer objects: the render thread renders
+  // 3D frames straight into GPU-visible memory and the texture is updated
+  // from it without blocking. 2D frames are still copied in from buffer(),
+  // which the next one builds on. Otherwise it is CPU memory that
+  // glTexSubImage2D copies from. A slot's storage belongs to whichever
+  // thread holds the slot in frames_: the render thread renders into the
+  // back slot without a lock, and the GL thread replaces only the others,
+  // so a resize never waits for a frame in progress.
+  Color* storage_[FrameQueue::kSlots] = {};
+  size_t storage_pixels_[FrameQueue::kSlots] = {};
+  std::vector<Color> cpu_storage_[FrameQueue::kSlots];
+  // Largest frame asked for so far, set on the GL thread.
+  size_t wanted_pixels_ = 0;
+  BufferStorageFunction buffer_storage_ = nullptr;
+  GLuint buffers_[FrameQueue::kSlots] = {};
+  // Set after each texture update from a buffer. The slot goes back to the
+  // render thread only once it is signaled.
+  GLsync fences_[FrameQueue::kSlots] = {};
+
+  // Requests from the GL thread, guarded by mutex_.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  RenderSettings requested_settings_;
+  uint32_t requested_width_ = 0;
+  uint32_t requested_height_ = 0;
+  bool requested_ = false;
+  bool stop_ = false;
+  std::function<void()> frame_ready_;
+
+  std::thread thread_;
+};
+
+}  // namespace render
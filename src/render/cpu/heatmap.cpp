@@ -0,0 +1,59 @@
+#include "render/cpu/heatmap.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace render {
+
+namespace {
+
+constexpr Color kHeatmapStops[] = {{0, 0, 0, 255},
+                                    {0, 0, 255, 255},
+                                    {255, 0, 0, 255},
+                                    {255, 255, 0, 255},
+                                    {255, 255, 255, 255}};
+
+uint8_t Lerp(uint8_t a, uint8_t b, float t) {
+  return static_cast<uint8_t>(a + (b - a) * t + 0.5f);
+}
+
+}  // namespace
+
+CostStats ComputeCostStats(const std::vector<uint32_t>& costs) {
+  CostStats stats;
+  if (costs.empty()) {
+    return stats;
+  }
+
+  uint64_t total = 0;
+  for (const uint32_t cost : costs) {
+    ++stats.histogram[std::bit_width(cost)];
+    stats.max = std::max(stats.max, cost);
+    total += cost;
+  }
+  stats.mean = static_cast<double>(total) / costs.size();
+
+  std::vector<uint32_t> sorted = costs;
+  const auto percentile = [&](size_t percent) {
+    const auto nth = sorted.begin() + (sorted.size() - 1) * percent / 100;
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return *nth;
+  };
+  stats.p50 = percentile(50);
+  stats.p99 = percentile(99);
+  return stats;
+}
+
+Color HeatmapColor(uint32_t cost, uint32_t scale) {
+  constexpr int kSegments = std::size(kHeatmapStops) - 1;
+  const float t =
+      std::min(static_cast<float>(cost) / std::max(scale, 1u), 1.0f) *
+      kSegments;
+  const int segment = std::min(static_cast<int>(t), kSegments - 1);
+  const float f = t - segment;
+  const Color& a = kHeatmapStops[segment];
+  const Color& b = kHeatmapStops[segment + 1];
+  return Color{Lerp(a.r, b.r, f), Lerp(a.g, b.g, f), Lerp(a.b, b.b, f), 255};
+}
+
+}  // namespace render
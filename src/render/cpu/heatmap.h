@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "render/common/types.h"
+
+namespace render {
+
+// Per-pixel cost summary of a heatmap frame.
+struct CostStats {
+  uint32_t p50 = 0;
+  uint32_t p99 = 0;
+  uint32_t max = 0;
+  double mean = 0.0;
+  // histogram[0] counts pixels of cost 0 and histogram[b] those of cost in
+  // [2^(b-1), 2^b).
+  std::array<uint64_t, 33> histogram{};
+};
+
+CostStats ComputeCostStats(const std::vector<uint32_t>& costs);
+
+// Black through blue, red and yellow to white as `cost` goes from 0 to
+// `scale`; costs above `scale` stay white.
+Color HeatmapColor(uint32_t cost, uint32_t scale);
+
+}  // namespace render
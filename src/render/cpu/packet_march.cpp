@@ -0,0 +1,43 @@
+#include "render/cpu/packet_march.h"
+
+#include "render/cpu/ray_packet.h"
+
+namespace render {
+
+namespace scalar {
+
+void MarchRays(const Ray* rays, const float* start_t, uint32_t count,
+               const RenderSettings& settings, const MarchLimits& limits,
+               MarchResult* out) {
+  packet::MarchRays<4>(rays, start_t, count, settings, limits, out);
+}
+
+}  // namespace scalar
+
+bool MarchesLaneByLane(const FractalSettings& fractal) {
+  switch (fractal.type) {
+    case FractalType::kJuliabulb:
+      return true;
+    case FractalType::kMandelbulb:
+      return MandelbulbIntegerPower(fractal.mandelbulb.power) == 0;
+    default:
+      return false;
+  }
+}
+
+PacketMarcher GetPacketMarcher(SimdLevel level) {
+#ifdef RENDER_X86_SIMD
+  switch (level) {
+    case SimdLevel::kAVX512:
+      return avx512::MarchRays;
+    case SimdLevel::kAVX2:
+      return avx2::MarchRays;
+    default:
+      return scalar::MarchRays;
+  }
+#else
+  return scalar::MarchRays;
+#endif
+}
+
+}  // namespace render
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+#include "render/common/types.h"
+#include "render/cpu/cpu_features.h"
+#include "render/settings_provider.h"
+
+namespace render {
+
+enum class MarchStatus : uint8_t {
+  kExhausted,
+  kHit,
+  kEscaped,
+};
+
+struct MarchResult {
+  float t;
+  MarchStatus status;
+  // SDF evaluations the ray took part in.
+  uint16_t steps;
+  // For hits on fractals colored by orbit traps, the trap of the hit's SDF
+  // evaluation, for GetFractalColor.
+  float trap;
+};
+
+struct MarchLimits {
+  int max_steps = 100;
+  // A ray hits when the distance drops below `hit_epsilon * t`.
+  float hit_epsilon = 0.001f;
+  // A ray escapes when the distance grows above `max_distance`.
+  float max_distance = 2.0f;
+  // Over-relaxed sphere tracing (Keinert et al., "Enhanced Sphere Tracing"):
+  // rays step this many times the distance while the distance spheres of
+  // consecutive steps overlap. A ray whose spheres stop overlapping may have
+  // stepped over the surface; it goes back to where a plain step would have
+  // taken it and relaxes half as much from there. On the bench scenes this
+  // saves about a tenth of the steps on the Mandelbulb and Juliabulb, little
+  // on the Mandelbox, and costs steps on the Menger sponge, whose flat faces
+  // relaxed steps keep overshooting. 1 is plain sphere tracing.
+  float relaxation = 1.0f;
+};
+
+// Sphere-traces `count` rays against the current fractal, several rays per
+// SDF evaluation. Only the march itself runs here; shading stays per pixel.
+// Ray i starts at `start_t[i]`, or at 0 if `start_t` is null. A start that
+// lands inside the surface falls back to 0.
+using PacketMarcher = void (*)(const Ray* rays, const float* start_t,
+                               uint32_t count, const RenderSettings& settings,
+                               const MarchLimits& limits, MarchResult* out);
+
+// Marcher for `level`, falling back to narrower ones the build lacks.
+PacketMarcher GetPacketMarcher(SimdLevel level);
+
+// Whether the packet SDF of `fractal` works lane by lane through scalar math
+// calls: the trig of the Juliabulb and of fractional Mandelbulb powers. Wider
+// packets gain nothing there and only keep more finished rays waiting, so
+// the wide marchers leave these fractals to the 4-wide one.
+bool MarchesLaneByLane(const FractalSettings& fractal);
+
+namespace scalar {
+
+// 4-wide packets, vectorized with the baseline instruction set.
+void MarchRays(const Ray* rays, const float* start_t, uint32_t count,
+               const RenderSettings& settings, const MarchLimits& limits,
+               MarchResult* out);
+
+}  // namespace scalar
+
+#ifdef RENDER_X86_SIMD
+namespace avx2 {
+
+// 8-wide packets.
+void MarchRays(const Ray* rays, const float* start_t, uint32_t count,
+               const RenderSettings& settings, const MarchLimits& limits,
+               MarchResult* out);
+
+}  // namespace avx2
+
+namespace avx512 {
+
+// 16-wide packets.
+void MarchRays(const Ray* rays, const float* start_t, uint32_t count,
+               const RenderSettings& settings, const MarchLimits& limits,
+               MarchResult* out);
+
+}  // namespace avx512
+#endif
+
+}  // namespace render
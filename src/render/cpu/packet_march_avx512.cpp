@@ -0,0 +1,16 @@
+#include "render/cpu/packet_march.h"
+#include "render/cpu/ray_packet.h"
+
+namespace render::avx512 {
+
+void MarchRays(const Ray* rays, const float* start_t, uint32_t count,
+               const RenderSettings& settings, const MarchLimits& limits,
+               MarchResult* out) {
+  if (MarchesLaneByLane(settings.fractal)) {
+    scalar::MarchRays(rays, start_t, count, settings, limits, out);
+    return;
+  }
+  packet::MarchRays<16>(rays, start_t, count, settings, limits, out);
+}
+
+}  // namespace render::avx512
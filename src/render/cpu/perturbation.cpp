@@ -0,0 +1,36 @@
+#include "render/cpu/perturbation.h"
+
+#include "render/cpu/trace.h"
+
+namespace render {
+
+ReferenceOrbit ComputeReferenceOrbit(const FixedPoint& c_re,
+                                     const FixedPoint& c_im, int max_iter) {
+  TraceSpan span("reference_orbit");
+  ReferenceOrbit orbit;
+  orbit.re.reserve(max_iter);
+  orbit.im.reserve(max_iter);
+
+  FixedPoint zr;
+  FixedPoint zi;
+  for (int i = 0; i < max_iter; ++i) {
+    const double re = zr.ToDouble();
+    const double im = zi.ToDouble();
+    orbit.re.push_back(re);
+    orbit.im.push_back(im);
+
+    if (re * re + im * im > 4.0) {
+      break;
+    }
+
+    // |Z| <= 2 here, so the products fit into the integer limb.
+    const FixedPoint zr2 = zr * zr;
+    const FixedPoint zi2 = zi * zi;
+    const FixedPoint zri = zr * zi;
+    zi = zri + zri + c_im;
+    zr = zr2 - zi2 + c_re;
+  }
+  return orbit;
+}
+
+}  // namespace render
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+#include "render/common/fixed_point.h"
+
+namespace render {
+
+// Orbit Z_0 = 0, Z_{n+1} = Z_n^2 + C of a deep-zoom reference point C. It is
+// iterated in FixedPoint and stored rounded to double, which is all the
+// EscapeTimeKernels::perturbed delta iteration needs. The orbit stops after
+// the first escaped value or at `max_iter` values.
+struct ReferenceOrbit {
+  std::vector<double> re;
+  std::vector<double> im;
+};
+
+ReferenceOrbit ComputeReferenceOrbit(const FixedPoint& c_re,
+                                     const FixedPoint& c_im, int max_iter);
+
+}  // namespace render
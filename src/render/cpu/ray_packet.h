@@ -0,0 +1,568 @@
+#pragma once
+
+#include <math.h>
+
+#include <cstdint>
+
+#include "render/common/fractals.h"
+#include "render/cpu/packet_march.h"
+#include "render/settings_provider.h"
+
+// SoA ray packets and packet versions of the 3D distance estimators. Every
+// function here loops over N independent lanes, which the compiler turns into
+// N-wide vector code when the including file is built for a matching ISA.
+//
+// Each ISA file instantiates these templates with its own N, so the
+// instantiations never collide at link time. For the same reason the code only
+// calls C math functions and no inline std:: helpers. Min/max are written as
+// selects, which vectorize where fminf/fmaxf calls would not.
+
+namespace render::packet {
+
+template <int N>
+struct Vector3dPacket {
+  float x[N];
+  float y[N];
+  float z[N];
+};
+
+template <int N>
+struct RayPacket {
+  Vector3dPacket<N> position;
+  Vector3dPacket<N> direction;
+};
+
+template <int N>
+inline void BoxSDF(const Vector3dPacket<N>& p, float* out) {
+  for (int l = 0; l < N; ++l) {
+    const float qx = fabsf(p.x[l]) - 1.0f;
+    const float qy = fabsf(p.y[l]) - 1.0f;
+    const float qz = fabsf(p.z[l]) - 1.0f;
+
+    const float mx = qx > 0.0f ? qx : 0.0f;
+    const float my = qy > 0.0f ? qy : 0.0f;
+    const float mz = qz > 0.0f ? qz : 0.0f;
+
+    const float qyz = qy > qz ? qy : qz;
+    const float q = qx > qyz ? qx : qyz;
+    out[l] = sqrtf(mx * mx + my * my + mz * mz) + (q < 0.0f ? q : 0.0f);
+  }
+}
+
+template <int N>
+inline void MengerSpongeSDF(const Vector3dPacket<N>& pos, int iterations,
+                            float* out) {
+  BoxSDF(pos, out);
+
+  float zx[N];
+  float zy[N];
+  float zz[N];
+  for (int l = 0; l < N; ++l) {
+    zx[l] = fabsf(pos.x[l]);
+    zy[l] = fabsf(pos.y[l]);
+    zz[l] = fabsf(pos.z[l]);
+  }
+
+  float scale = 1.0f;
+  for (int m = 0; m < iterations; ++m) {
+    const float next_scale = scale * 3.0f;
+
+    for (int l = 0; l < N; ++l) {
+      // The arguments are never negative, so fmod(v, 2) is v - 2 floor(v / 2).
+      const float vx = zx[l] * scale;
+      const float vy = zy[l] * scale;
+      const float vz = zz[l] * scale;
+      const float ax = vx - 2.0f * floorf(vx * 0.5f) - 1.0f;
+      const float ay = vy - 2.0f * floorf(vy * 0.5f) - 1.0f;
+      const float az = vz - 2.0f * floorf(vz * 0.5f) - 1.0f;
+
+      const float rx = fabsf(1.0f - fabsf(ax) * 3.0f);
+      const float ry = fabsf(1.0f - fabsf(ay) * 3.0f);
+      const float rz = fabsf(1.0f - fabsf(az) * 3.0f);
+
+      const float da = rx > ry ? rx : ry;
+      const float db = ry > rz ? ry : rz;
+      const float dc = rz > rx ? rz : rx;
+      const float dbc = db < dc ? db : dc;
+      const float c = ((da < dbc ? da : dbc) - 1.0f) / next_scale;
+
+      out[l] = out[l] > c ? out[l] : c;
+    }
+
+    scale = next_scale;
+  }
+}
+
+template <int N>
+inline void MandelboxSDF(const Vector3dPacket<N>& pos, int iterations,
+                         float min_radius, float fixed_radius, float scale,
+                         float* out) {
+  float zx[N];
+  float zy[N];
+  float zz[N];
+  float dr[N];
+  // 1 while the lane is iterating, 0 once it escaped.
+  int active[N];
+  for (int l = 0; l < N; ++l) {
+    zx[l] = pos.x[l];
+    zy[l] = pos.y[l];
+    zz[l] = pos.z[l];
+    dr[l] = 1.0f;
+    active[l] = 1;
+  }
+
+  const float min_r2 = min_radius * min_radius;
+  const float fixed_r2 = fixed_radius * fixed_radius;
+  const float abs_scale = fabsf(scale);
+
+  for (int i = 0; i < iterations; ++i) {
+    int active_lanes = 0;
+
+    for (int l = 0; l < N; ++l) {
+      // Box fold.
+      const float cx = zx[l] < -1.0f ? -1.0f : (zx[l] > 1.0f ? 1.0f : zx[l]);
+      const float cy = zy[l] < -1.0f ? -1.0f : (zy[l] > 1.0f ? 1.0f : zy[l]);
+      const float cz = zz[l] < -1.0f ? -1.0f : (zz[l] > 1.0f ? 1.0f : zz[l]);
+      float x = cx * 2.0f - zx[l];
+      float y = cy * 2.0f - zy[l];
+      float z = cz * 2.0f - zz[l];
+
+      // Sphere fold.
+      const float r2 = x * x + y * y + z * z;
+      const float factor = r2 < min_r2     ? fixed_r2 / min_r2
+                           : r2 < fixed_r2 ? fixed_r2 / r2
+                                           : 1.0f;
+      x = x * factor * scale + pos.x[l];
+      y = y * factor * scale + pos.y[l];
+      z = z * factor * scale + pos.z[l];
+      const float d = dr[l] * factor * abs_scale + 1.0f;
+
+      const bool was_active = active[l] != 0;
+      zx[l] = was_active ? x : zx[l];
+      zy[l] = was_active ? y : zy[l];
+      zz[l] = was_active ? z : zz[l];
+      dr[l] = was_active ? d : dr[l];
+
+      const bool escaped = x * x + y * y + z * z > 100.0f * 100.0f;
+      active[l] = was_active && !escaped ? 1 : 0;
+      active_lanes += active[l];
+    }
+
+    if (active_lanes == 0) {
+      break;
+    }
+  }
+
+  for (int l = 0; l < N; ++l) {
+    out[l] = sqrtf(zx[l] * zx[l] + zy[l] * zy[l] + zz[l] * zz[l]) / dr[l];
+  }
+}
+
+// MandelbulbSDF for whole powers of at least 2, without trig; see
+// render::TriplexPower. The power's bits are walked outside the lane loops,
+// which then stay branch-free. Like the other orbit-trap fractals it also
+// writes each lane's trap, as render::MandelbulbSDF does.
+template <int N>
+inline void MandelbulbIntegerSDF(const Vector3dPacket<N>& pos, int iterations,
+                                 int power, float bailout, float* out,
+                                 float* trap) {
+  float zx[N];
+  float zy[N];
+  float zz[N];
+  float dr[N];
+  float r[N];
+  bool escaped[N];
+  for (int l = 0; l < N; ++l) {
+    zx[l] = pos.x[l];
+    zy[l] = pos.y[l];
+    zz[l] = pos.z[l];
+    dr[l] = 1.0f;
+    r[l] = 0.0f;
+    escaped[l] = false;
+    trap[l] = 1e20f;
+  }
+
+  // Per lane: cos + i sin of the azimuth and of the polar angle, and the
+  // length, as bases and as the powers built from them.
+  float phi_re[N];
+  float phi_im[N];
+  float theta_re[N];
+  float theta_im[N];
+  float length[N];
+  float phi_n_re[N];
+  float phi_n_im[N];
+  float theta_n_re[N];
+  float theta_n_im[N];
+  float length_n[N];
+
+  for (int i = 0; i < iterations; ++i) {
+    bool any_active = false;
+
+    for (int l = 0; l < N; ++l) {
+      if (escaped[l]) {
+        continue;
+      }
+
+      r[l] = sqrtf(zx[l] * zx[l] + zy[l] * zy[l] + zz[l] * zz[l]);
+      if (r[l] > bailout) {
+        escaped[l] = true;
+        continue;
+      }
+      any_active = true;
+      trap[l] = r[l] < trap[l] ? r[l] : trap[l];
+    }
+
+    if (!any_active) {
+      break;
+    }
+
+    for (int l = 0; l < N; ++l) {
+      const float rho = sqrtf(zx[l] * zx[l] + zy[l] * zy[l]);
+      const bool axis = rho > 0.0f;
+      phi_re[l] = axis ? zx[l] / rho : 1.0f;
+      phi_im[l] = axis ? zy[l] / rho : 0.0f;
+      theta_re[l] = zz[l] / r[l];
+      theta_im[l] = rho / r[l];
+      length[l] = r[l];
+      phi_n_re[l] = 1.0f;
+      phi_n_im[l] = 0.0f;
+      theta_n_re[l] = 1.0f;
+      theta_n_im[l] = 0.0f;
+      length_n[l] = 1.0f;
+    }
+
+    for (int e = power; e > 0; e >>= 1) {
+      if (e & 1) {
+        for (int l = 0; l < N; ++l) {
+          const float p_re = phi_n_re[l] * phi_re[l] - phi_n_im[l] * phi_im[l];
+          phi_n_im[l] = phi_n_re[l] * phi_im[l] + phi_n_im[l] * phi_re[l];
+          phi_n_re[l] = p_re;
+          const float t_re =
+              theta_n_re[l] * theta_re[l] - theta_n_im[l] * theta_im[l];
+          theta_n_im[l] =
+              theta_n_re[l] * theta_im[l] + theta_n_im[l] * theta_re[l];
+          theta_n_re[l] = t_re;
+          length_n[l] *= length[l];
+        }
+      }
+      if (e > 1) {
+        for (int l = 0; l < N; ++l) {
+          const float p_re = phi_re[l] * phi_re[l] - phi_im[l] * phi_im[l];
+          phi_im[l] = 2.0f * phi_re[l] * phi_im[l];
+          phi_re[l] = p_re;
+          const float t_re =
+              theta_re[l] * theta_re[l] - theta_im[l] * theta_im[l];
+          theta_im[l] = 2.0f * theta_re[l] * theta_im[l];
+          theta_re[l] = t_re;
+          length[l] *= length[l];
+        }
+      }
+    }
+
+    for (int l = 0; l < N; ++l) {
+      if (escaped[l]) {
+        continue;
+      }
+      dr[l] = length_n[l] / r[l] * power * dr[l] + 1.0f;
+      zx[l] = length_n[l] * theta_n_im[l] * phi_n_re[l] + pos.x[l];
+      zy[l] = length_n[l] * theta_n_im[l] * phi_n_im[l] + pos.y[l];
+      zz[l] = length_n[l] * theta_n_re[l] + pos.z[l];
+    }
+  }
+
+  for (int l = 0; l < N; ++l) {
+    out[l] = 0.5f * logf(r[l]) * r[l] / dr[l];
+  }
+}
+
+template <int N>
+inline void MandelbulbSDF(const Vector3dPacket<N>& pos, int iterations,
+                          float power, float bailout, float* out,
+                          float* trap) {
+  const int whole = static_cast<int>(power);
+  if (whole == power && whole >= 2 && whole <= kMaxMandelbulbIntegerPower) {
+    MandelbulbIntegerSDF(pos, iterations, whole, bailout, out, trap);
+    return;
+  }
+
+  float zx[N];
+  float zy[N];
+  float zz[N];
+  float dr[N];
+  float r[N];
+  bool escaped[N];
+  for (int l = 0; l < N; ++l) {
+    zx[l] = pos.x[l];
+    zy[l] = pos.y[l];
+    zz[l] = pos.z[l];
+    dr[l] = 1.0f;
+    r[l] = 0.0f;
+    escaped[l] = false;
+    trap[l] = 1e20f;
+  }
+
+  for (int i = 0; i < iterations; ++i) {
+    bool any_active = false;
+
+    for (int l = 0; l < N; ++l) {
+      if (escaped[l]) {
+        continue;
+      }
+
+      r[l] = sqrtf(zx[l] * zx[l] + zy[l] * zy[l] + zz[l] * zz[l]);
+      if (r[l] > bailout) {
+        escaped[l] = true;
+        continue;
+      }
+      any_active = true;
+      trap[l] = r[l] < trap[l] ? r[l] : trap[l];
+
+      const float theta = acosf(zz[l] / r[l]) * power;
+      const float phi = atan2f(zy[l], zx[l]) * power;
+
+      float zr = powf(r[l], power - 1.0f);
+      dr[l] = zr * power * dr[l] + 1.0f;
+      zr *= r[l];
+
+      const float sin_theta = sinf(theta);
+      zx[l] = zr * sin_theta * cosf(phi) + pos.x[l];
+      zy[l] = zr * sin_theta * sinf(phi) + pos.y[l];
+      zz[l] = zr * cosf(theta) + pos.z[l];
+    }
+
+    if (!any_active) {
+      break;
+    }
+  }
+
+  for (int l = 0; l < N; ++l) {
+    out[l] = 0.5f * logf(r[l]) * r[l] / dr[l];
+  }
+}
+
+template <int N>
+inline void JuliabulbSDF(const Vector3dPacket<N>& pos, int iterations,
+                         const Vector3d& c, float power, float* out,
+                         float* trap) {
+  const float bailout = 2.0f;
+
+  float zx[N];
+  float zy[N];
+  float zz[N];
+  float dr[N];
+  float r[N];
+  bool escaped[N];
+  for (int l = 0; l < N; ++l) {
+    zx[l] = pos.x[l];
+    zy[l] = pos.y[l];
+    zz[l] = pos.z[l];
+    dr[l] = 1.0f;
+    r[l] = 0.0f;
+    escaped[l] = false;
+    trap[l] = 1e20f;
+  }
+
+  for (int i = 0; i < iterations; ++i) {
+    bool any_active = false;
+
+    for (int l = 0; l < N; ++l) {
+      if (escaped[l]) {
+        continue;
+      }
+
+      r[l] = sqrtf(zx[l] * zx[l] + zy[l] * zy[l] + zz[l] * zz[l]);
+      if (r[l] > bailout) {
+        escaped[l] = true;
+        continue;
+      }
+      any_active = true;
+      trap[l] = r[l] < trap[l] ? r[l] : trap[l];
+
+      float r_pow = powf(r[l], power - 1.0f);
+      dr[l] = r_pow * power * dr[l] + 1.0f;
+
+      const float theta =
+          acosf(fminf(fmaxf(zz[l] / r[l], -1.0f), 1.0f)) * power;
+      const float phi = atan2f(zy[l], zx[l]) * power;
+
+      const float sin_theta = sinf(theta);
+      r_pow *= r[l];
+      zx[l] = r_pow * sin_theta * cosf(phi) + c.x;
+      zy[l] = r_pow * cosf(theta) + c.y;
+      zz[l] = r_pow * sin_theta * sinf(phi) + c.z;
+    }
+
+    if (!any_active) {
+      break;
+    }
+  }
+
+  for (int l = 0; l < N; ++l) {
+    out[l] = 0.5f * logf(r[l]) * r[l] / dr[l];
+  }
+}
+
+// Distance estimates of fractal `kType` for N positions. The type is a
+// template argument so MarchPacket compiles to one loop per fractal. Fractals
+// colored by orbit traps also write them to `trap`.
+template <FractalType kType, int N>
+inline void SignedDistance(const Vector3dPacket<N>& pos,
+                           const FractalSettings& fractal, float* out,
+                           float* trap) {
+  if constexpr (kType == FractalType::kMengerSponge) {
+    MengerSpongeSDF(pos, fractal.max_iterations, out);
+  } else if constexpr (kType == FractalType::kMandelbulb) {
+    MandelbulbSDF(pos, fractal.max_iterations, fractal.mandelbulb.power,
+                  fractal.mandelbulb.boilout, out, trap);
+  } else if constexpr (kType == FractalType::kMandelbox) {
+    MandelboxSDF(pos, fractal.max_iterations, fractal.mandelbox.min_radius,
+                 fractal.mandelbox.fixed_radius, fractal.mandelbox.scale, out);
+  } else if constexpr (kType == FractalType::kJuliabulb) {
+    JuliabulbSDF(pos, fractal.max_iterations, fractal.juliabulb.c,
+                 fractal.juliabulb.power, out, trap);
+  } else {
+    for (int l = 0; l < N; ++l) {
+      out[l] = 100.0f;
+    }
+  }
+}
+
+// Sphere-traces up to N rays together. Lanes past `count` and lanes whose ray
+// already hit or escaped are masked out and keep their results. With
+// `limits.relaxation` above 1 each lane over-relaxes, by half as much more
+// after each overshoot.
+template <FractalType kType, int N>
+inline void MarchPacket(const Ray* rays, const float* start_t, uint32_t count,
+                        const FractalSettings& fractal,
+                        const MarchLimits& limits, MarchResult* out) {
+  RayPacket<N> packet;
+  float t[N];
+  bool active[N];
+  MarchStatus status[N];
+  uint16_t steps[N];
+  float hit_trap[N];
+  // Relaxation factor, distance at the last point and length of the last
+  // step of each lane.
+  float relaxation[N];
+  float radius[N];
+  float stride[N];
+  for (int l = 0; l < N; ++l) {
+    const Ray& ray = rays[static_cast<uint32_t>(l) < count ? l : 0];
+    packet.position.x[l] = ray.position.x;
+    packet.position.y[l] = ray.position.y;
+    packet.position.z[l] = ray.position.z;
+    packet.direction.x[l] = ray.direction.x;
+    packet.direction.y[l] = ray.direction.y;
+    packet.direction.z[l] = ray.direction.z;
+    t[l] = start_t && static_cast<uint32_t>(l) < count ? start_t[l] : 0.0f;
+    active[l] = static_cast<uint32_t>(l) < count;
+    status[l] = MarchStatus::kExhausted;
+    steps[l] = 0;
+    hit_trap[l] = 0.0f;
+    relaxation[l] = limits.relaxation;
+    radius[l] = 0.0f;
+    stride[l] = 0.0f;
+  }
+
+  Vector3dPacket<N> pos;
+  float distance[N];
+  float trap[N] = {};
+
+  for (int step = 0; step < limits.max_steps; ++step) {
+    for (int l = 0; l < N; ++l) {
+      pos.x[l] = packet.position.x[l] + packet.direction.x[l] * t[l];
+      pos.y[l] = packet.position.y[l] + packet.direction.y[l] * t[l];
+      pos.z[l] = packet.position.z[l] + packet.direction.z[l] * t[l];
+    }
+
+    SignedDistance<kType, N>(pos, fractal, distance, trap);
+
+    bool any_active = false;
+    for (int l = 0; l < N; ++l) {
+      if (!active[l]) {
+        continue;
+      }
+
+      ++steps[l];
+      if (step == 0 && distance[l] < 0.0f && t[l] > 0.0f) {
+        // The start distance overshot into the surface: march from 0.
+        t[l] = 0.0f;
+        any_active = true;
+      } else if (relaxation[l] > 1.0f && stride[l] > 0.0f &&
+                 (distance[l] < 0.0f ||
+                  distance[l] + radius[l] < stride[l])) {
+        // The spheres do not overlap, so the surface may lie between the
+        // points: step back to where a plain step would have gone, take the
+        // next step from there unchecked and relax half as much.
+        t[l] -= stride[l] - radius[l];
+        relaxation[l] = 1.0f + (relaxation[l] - 1.0f) * 0.5f;
+        stride[l] = 0.0f;
+        any_active = true;
+      } else if (distance[l] < limits.hit_epsilon * t[l]) {
+        status[l] = MarchStatus::kHit;
+        hit_trap[l] = trap[l];
+        active[l] = false;
+      } else if (distance[l] > limits.max_distance) {
+        status[l] = MarchStatus::kEscaped;
+        active[l] = false;
+      } else {
+        radius[l] = distance[l];
+        stride[l] = distance[l] * relaxation[l];
+        t[l] += stride[l];
+        any_active = true;
+      }
+    }
+
+    if (!any_active) {
+      break;
+    }
+  }
+
+  for (uint32_t l = 0; l < count; ++l) {
+    out[l] = MarchResult{t[l], status[l], steps[l], hit_trap[l]};
+  }
+}
+
+template <FractalType kType, int N>
+inline void MarchRays(const Ray* rays, const float* start_t, uint32_t count,
+                      const FractalSettings& fractal,
+                      const MarchLimits& limits, MarchResult* out) {
+  for (uint32_t i = 0; i < count; i += N) {
+    const uint32_t lanes = count - i < N ? count - i : N;
+    MarchPacket<kType, N>(rays + i, start_t ? start_t + i : nullptr, lanes,
+                          fractal, limits, out + i);
+  }
+}
+
+// Marches `count` rays in packets of N, switching on the fractal type once
+// for all of them.
+template <int N>
+inline void MarchRays(const Ray* rays, const float* start_t, uint32_t count,
+                      const RenderSettings& settings,
+                      const MarchLimits& limits, MarchResult* out) {
+  const auto& fractal = settings.fractal;
+  switch (fractal.type) {
+    case FractalType::kMengerSponge:
+      MarchRays<FractalType::kMengerSponge, N>(rays, start_t, count, fractal,
+                                               limits, out);
+      break;
+    case FractalType::kMandelbulb:
+      MarchRays<FractalType::kMandelbulb, N>(rays, start_t, count, fractal,
+                                             limits, out);
+      break;
+    case FractalType::kMandelbox:
+      MarchRays<FractalType::kMandelbox, N>(rays, start_t, count, fractal,
+                                            limits, out);
+      break;
+    case FractalType::kJuliabulb:
+      MarchRays<FractalType::kJuliabulb, N>(rays, start_t, count, fractal,
+                                            limits, out);
+      break;
+    default:
+      MarchRays<FractalType::kMandelbrot, N>(rays, start_t, count, fractal,
+                                             limits, out);
+      break;
+  }
+}
+
+}  // namespace render::packet
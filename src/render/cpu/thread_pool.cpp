@@ -0,0 +1,133 @@
+#include "render/cpu/thread_pool.h"
+
+#include <algorithm>
+#include <string>
+
+#include "render/cpu/trace.h"
+
+namespace render {
+
+ThreadPool::ThreadPool(uint32_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (uint32_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (uint32_t i = 1; i < threads; ++i) {
+    threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::ParallelFor(
+    uint32_t count, const std::function<void(uint32_t, uint32_t)>& task) {
+  if (count == 0) {
+    return;
+  }
+
+  task_ = &task;
+  remaining_.store(count);
+
+  // Contiguous blocks keep neighbouring tasks on one worker; stealing takes
+  // care of the imbalance.
+  const uint32_t workers = size();
+  for (uint32_t w = 0; w < workers; ++w) {
+    const uint32_t begin = static_cast<uint64_t>(count) * w / workers;
+    const uint32_t end = static_cast<uint64_t>(count) * (w + 1) / workers;
+
+    std::lock_guard lock(queues_[w]->mutex);
+    for (uint32_t i = begin; i < end; ++i) {
+      queues_[w]->tasks.push_back(i);
+    }
+  }
+
+  {
+    std::lock_guard lock(mutex_);
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  RunTasks(0);
+
+  std::unique_lock lock(mutex_);
+  done_.wait(lock, [this] { return remaining_.load() == 0; });
+  task_ = nullptr;
+}
+
+uint32_t ThreadPool::size() const {
+  return static_cast<uint32_t>(queues_.size());
+}
+
+void ThreadPool::WorkerLoop(uint32_t worker) {
+  Tracer::Get().SetThreadName("worker " + std::to_string(worker));
+  uint64_t seen_generation = 0;
+
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock,
+                 [&] { return stop_ || generation_ != seen_generation; });
+      if (stop_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    RunTasks(worker);
+  }
+}
+
+void ThreadPool::RunTasks(uint32_t worker) {
+  uint32_t task;
+  while (PopTask(worker, &task) || StealTask(worker, &task)) {
+    (*task_)(task, worker);
+
+    if (remaining_.fetch_sub(1) == 1) {
+      std::lock_guard lock(mutex_);
+      done_.notify_all();
+    }
+  }
+}
+
+bool ThreadPool::PopTask(uint32_t worker, uint32_t* task) {
+  auto& queue = *queues_[worker];
+  std::lock_guard lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+
+  *task = queue.tasks.front();
+  queue.tasks.pop_front();
+  return true;
+}
+
+bool ThreadPool::StealTask(uint32_t worker, uint32_t* task) {
+  const uint32_t workers = size();
+  for (uint32_t i = 1; i < workers; ++i) {
+    auto& victim = *queues_[(worker + i) % workers];
+    std::lock_guard lock(victim.mutex);
+    if (victim.tasks.empty()) {
+      continue;
+    }
+
+    *task = victim.tasks.back();
+    victim.tasks.pop_back();
+    return true;
+  }
+  return false;
+}
+
+}  // namespace render
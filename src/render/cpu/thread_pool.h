@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace render {
+
+// Persistent pool of worker threads with per-worker task queues.
+// Idle workers steal tasks from the back of other queues, so uneven task
+// costs (e.g. ray-marched tiles) still keep every core busy.
+class ThreadPool {
+ public:
+  // `threads == 0` uses std::thread::hardware_concurrency().
+  explicit ThreadPool(uint32_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Runs `task(index, worker)` for every index in [0, count) and blocks until
+  // all of them are done. The calling thread takes part as worker 0.
+  void ParallelFor(uint32_t count,
+                   const std::function<void(uint32_t, uint32_t)>& task);
+
+  uint32_t size() const;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<uint32_t> tasks;
+  };
+
+  void WorkerLoop(uint32_t worker);
+  void RunTasks(uint32_t worker);
+  bool PopTask(uint32_t worker, uint32_t* task);
+  bool StealTask(uint32_t worker, uint32_t* task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+
+  const std::function<void(uint32_t, uint32_t)>* task_ = nullptr;
+  std::atomic<uint32_t> remaining_ = 0;
+};
+
+}  // namespace render
@@ -0,0 +1,155 @@
+#include "render/cpu/tile_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace render {
+
+namespace {
+
+// Frames within this fraction of a pixel of a level's lattice reuse its
+// tiles, as in the incremental pan.
+constexpr double kAlignTolerance = 1e-3;
+// Lattice offsets stay exact in double up to here.
+constexpr double kMaxLatticeOffset = 4503599627370496.0;  // 2^52
+
+// Pixels of a tile plus a rough allowance for its list and index nodes.
+size_t EntryBytes(size_t pixels) {
+  return pixels * sizeof(Color) + 64;
+}
+
+}  // namespace
+
+size_t TileCache::KeyHash::operator()(const Key& key) const {
+  uint64_t hash = key.level_id;
+  hash = hash * 0x9e3779b97f4a7c15ull ^ static_cast<uint64_t>(key.x);
+  hash = hash * 0x9e3779b97f4a7c15ull ^ static_cast<uint64_t>(key.y);
+  return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+TileCache::TileCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+bool TileCache::enabled() const { return max_bytes_ > 0; }
+
+bool TileCache::Align(const TileLevel& level, const FixedPoint& origin_x,
+                      const FixedPoint& origin_y, uint32_t* level_id,
+                      int64_t* x, int64_t* y) {
+  std::lock_guard lock(mutex_);
+
+  // Levels whose tiles were all evicted lose their anchor.
+  std::erase_if(levels_, [&](const Level& entry) {
+    return entry.tiles == 0 && entry.level != level;
+  });
+
+  auto it = std::find_if(levels_.begin(), levels_.end(),
+                         [&](const Level& entry) {
+                           return entry.level == level;
+                         });
+  if (it == levels_.end()) {
+    levels_.push_back({next_level_id_++, level, origin_x, origin_y});
+    *level_id = levels_.back().id;
+    *x = 0;
+    *y = 0;
+    return true;
+  }
+
+  const double px = (origin_x - it->anchor_x).ToDouble() / level.spacing_x;
+  const double py = (origin_y - it->anchor_y).ToDouble() / level.spacing_y;
+  const double rx = std::round(px);
+  const double ry = std::round(py);
+  if (std::fabs(px - rx) > kAlignTolerance ||
+      std::fabs(py - ry) > kAlignTolerance ||
+      std::fabs(rx) > kMaxLatticeOffset || std::fabs(ry) > kMaxLatticeOffset) {
+    return false;
+  }
+
+  *level_id = it->id;
+  *x = static_cast<int64_t>(rx);
+  *y = static_cast<int64_t>(ry);
+  return true;
+}
+
+bool TileCache::Find(uint32_t level_id, int64_t x, int64_t y, Color* out) {
+  std::lock_guard lock(mutex_);
+
+  const auto it = index_.find({level_id, x, y});
+  if (it == index_.end()) {
+    ++stats_.misses;
+    return false;
+  }
+
+  ++stats_.hits;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  const auto& pixels = it->second->pixels;
+  std::copy(pixels.begin(), pixels.end(), out);
+  return true;
+}
+
+void TileCache::Insert(uint32_t level_id, int64_t x, int64_t y,
+                       const Color* pixels) {
+  std::lock_guard lock(mutex_);
+
+  Level* level = FindLevel(level_id);
+  if (!level) {
+    return;
+  }
+  const size_t count = level->level.tile_size * level->level.tile_size;
+  if (EntryBytes(count) > max_bytes_) {
+    return;
+  }
+
+  const Key key{level_id, x, y};
+  const auto it = index_.find(key);
+  if (it != index_.end()) {
+    std::copy(pixels, pixels + count, it->second->pixels.begin());
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+
+  while (!entries_.empty() &&
+         stats_.bytes + EntryBytes(count) > max_bytes_) {
+    EvictOldest();
+  }
+  entries_.push_front({key, std::vector<Color>(pixels, pixels + count)});
+  index_.emplace(key, entries_.begin());
+  ++level->tiles;
+  ++stats_.tiles;
+  stats_.bytes += EntryBytes(count);
+}
+
+TileCache::Stats TileCache::stats() const {
+  std::lock_guard lock(mutex_);
+  return stats_;
+}
+
+void TileCache::Clear() {
+  std::lock_guard lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  levels_.clear();
+  stats_.tiles = 0;
+  stats_.bytes = 0;
+}
+
+TileCache::Level* TileCache::FindLevel(uint32_t level_id) {
+  for (auto& level : levels_) {
+    if (level.id == level_id) {
+      return &level;
+    }
+  }
+  return nullptr;
+}
+
+void TileCache::EvictOldest() {
+  const Entry& oldest = entries_.back();
+  if (Level* level = FindLevel(oldest.key.level_id)) {
+    --level->tiles;
+  }
+  stats_.bytes -= EntryBytes(oldest.pixels.size());
+  --stats_.tiles;
+  ++stats_.evictions;
+  index_.erase(oldest.key);
+  entries_.pop_back();
+}
+
+}  // namespace render
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "render/common/fixed_point.h"
+#include "render/common/types.h"
+#include "render/settings_provider.h"
+
+namespace render {
+
+// Everything but the position that decides what a 2D pixel shows: tiles of
+// one level can be reused by any frame on the same pixel lattice.
+struct TileLevel {
+  FractalType type = FractalType::kMandelbrot;
+  uint32_t max_iterations = 0;
+  JuliaParams julia;
+  // Plane units per pixel.
+  double spacing_x = 0.0;
+  double spacing_y = 0.0;
+  // Precision tier the tiles are iterated in.
+  uint8_t precision = 0;
+  uint32_t tile_size = 0;
+
+  bool operator==(const TileLevel& other) const {
+    return type == other.type && max_iterations == other.max_iterations &&
+           julia.c_re == other.julia.c_re && julia.c_im == other.julia.c_im &&
+           spacing_x == other.spacing_x && spacing_y == other.spacing_y &&
+           precision == other.precision && tile_size == other.tile_size;
+  }
+};
+
+// Colored 2D tiles kept across frames, like a map tile pyramid: a tile is
+// found by its level and its coordinates on the level's pixel lattice.
+// The least recently used tiles are evicted to stay within a memory budget.
+// Find and Insert may be called from several threads.
+class TileCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t tiles = 0;
+    size_t bytes = 0;
+  };
+
+  // `max_bytes == 0` disables the cache.
+  explicit TileCache(size_t max_bytes);
+
+  bool enabled() const;
+
+  // Places a frame on the lattice of `level`. The lattice of a level is
+  // anchored at the first frame seen with it; a later frame is on it when
+  // its top left corner (origin_x, origin_y) is a whole number of pixels
+  // away. Then sets the level id for Find and Insert and the lattice pixel
+  // of the frame's pixel (0, 0). Returns false otherwise.
+  bool Align(const TileLevel& level, const FixedPoint& origin_x,
+             const FixedPoint& origin_y, uint32_t* level_id, int64_t* x,
+             int64_t* y);
+
+  // Copies the tile_size x tile_size pixels of tile (x, y) into `out` and
+  // returns true if the tile is cached.
+  bool Find(uint32_t level_id, int64_t x, int64_t y, Color* out);
+  void Insert(uint32_t level_id, int64_t x, int64_t y, const Color* pixels);
+
+  Stats stats() const;
+  void Clear();
+
+ private:
+  struct Key {
+    uint32_t level_id;
+    int64_t x;
+    int64_t y;
+
+    bool operator==(const Key& other) const {
+      return level_id == other.level_id && x == other.x && y == other.y;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Entry {
+    Key key;
+    std::vector<Color> pixels;
+  };
+
+  struct Level {
+    uint32_t id;
+    TileLevel level;
+    FixedPoint anchor_x;
+    FixedPoint anchor_y;
+    size_t tiles = 0;
+  };
+
+  Level* FindLevel(uint32_t level_id);
+  void EvictOldest();
+
+  const size_t max_bytes_;
+
+  mutable std::mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+  std::vector<Level> levels_;
+  uint32_t next_level_id_ = 0;
+  Stats stats_;
+};
+
+}  // namespace render
@@ -0,0 +1,139 @@
+#include "render/cpu/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+namespace render {
+
+namespace {
+
+uint32_t ThreadId() {
+  static std::atomic<uint32_t> next_id{1};
+  thread_local const uint32_t id = next_id.fetch_add(1);
+  return id;
+}
+
+struct Span {
+  const char* name;
+  uint32_t thread;
+  int64_t start_ns;
+  int64_t end_ns;
+};
+
+void WriteJsonString(std::ostream& out, const std::string& value) {
+  out << '"';
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+}  // namespace
+
+Tracer& Tracer::Get() {
+  static Tracer tracer;
+  return tracer;
+}
+
+void Tracer::Start() {
+  std::call_once(allocate_,
+                 [this] { slots_ = std::make_unique<Slot[]>(kCapacity); });
+  first_.store(next_.load());
+  enabled_.store(true, std::memory_order_release);
+}
+
+void Tracer::Stop() { enabled_.store(false, std::memory_order_release); }
+
+void Tracer::Record(const char* name, int64_t start_ns, int64_t end_ns) {
+  if (!enabled()) {
+    return;
+  }
+
+  const uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[index % kCapacity];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.thread.store(ThreadId(), std::memory_order_relaxed);
+  slot.start_ns.store(start_ns, std::memory_order_relaxed);
+  slot.end_ns.store(end_ns, std::memory_order_relaxed);
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+void Tracer::SetThreadName(const std::string& name) {
+  std::lock_guard lock(names_mutex_);
+  thread_names_[ThreadId()] = name;
+}
+
+void Tracer::WriteChromeJson(std::ostream& out) const {
+  std::vector<Span> spans;
+  if (slots_) {
+    const uint64_t first = first_.load();
+    const uint64_t end = next_.load();
+    const uint64_t begin =
+        std::max(first, end > kCapacity ? end - kCapacity : 0);
+    spans.reserve(end - begin);
+    for (uint64_t index = begin; index < end; ++index) {
+      const Slot& slot = slots_[index % kCapacity];
+      const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence != 2 * index + 2) {
+        // Still being written, or already overwritten by a newer span.
+        continue;
+      }
+      const Span span{slot.name.load(std::memory_order_relaxed),
+                      slot.thread.load(std::memory_order_relaxed),
+                      slot.start_ns.load(std::memory_order_relaxed),
+                      slot.end_ns.load(std::memory_order_relaxed)};
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        spans.push_back(span);
+      }
+    }
+  }
+  std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) {
+    return a.start_ns < b.start_ns;
+  });
+  const int64_t origin = spans.empty() ? 0 : spans.front().start_ns;
+
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first_event = true;
+  {
+    std::lock_guard lock(names_mutex_);
+    for (const auto& [thread, name] : thread_names_) {
+      out << (first_event ? "\n" : ",\n")
+          << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+          << thread << ",\"args\":{\"name\":";
+      WriteJsonString(out, name);
+      out << "}}";
+      first_event = false;
+    }
+  }
+  for (const Span& span : spans) {
+    // Chrome trace timestamps are microseconds.
+    out << (first_event ? "\n" : ",\n") << "{\"name\":";
+    WriteJsonString(out, span.name);
+    out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread
+        << ",\"ts\":" << (span.start_ns - origin) * 1e-3
+        << ",\"dur\":" << (span.end_ns - span.start_ns) * 1e-3 << "}";
+    first_event = false;
+  }
+  out << "\n]}\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+int64_t Tracer::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace render
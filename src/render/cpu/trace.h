@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace render {
+
+// Process-wide recorder of timed spans, for seeing where a frame's time
+// goes and how evenly tiles spread over threads. Spans go into a fixed ring
+// that keeps the newest kCapacity of them; recording one takes a few atomic
+// operations and no locks, and nothing is recorded while stopped.
+class Tracer {
+ public:
+  static constexpr size_t kCapacity = size_t{1} << 18;
+
+  static Tracer& Get();
+
+  // Drops the spans recorded so far and starts recording.
+  void Start();
+  void Stop();
+  bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+
+  // `name` must stay valid for the life of the process, e.g. a literal.
+  void Record(const char* name, int64_t start_ns, int64_t end_ns);
+  // Names the calling thread in the written trace.
+  void SetThreadName(const std::string& name);
+
+  // Writes the recorded spans as Chrome trace event JSON, which
+  // chrome://tracing and Perfetto open. Safe while spans are recorded.
+  void WriteChromeJson(std::ostream& out) const;
+
+  // Nanoseconds on the clock spans are measured with.
+  static int64_t Now();
+
+ private:
+  // Written like a seqlock: `sequence` is odd while the slot is written and
+  // 2 * (index + 1) once span number `index` is complete.
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint32_t> thread{0};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> end_ns{0};
+  };
+
+  Tracer() = default;
+
+  std::atomic<bool> enabled_{false};
+  std::once_flag allocate_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> next_{0};
+  // Index of the first span of the current recording.
+  std::atomic<uint64_t> first_{0};
+
+  mutable std::mutex names_mutex_;
+  std::map<uint32_t, std::string> thread_names_;
+};
+
+// Records the time from its construction to its destruction as a span.
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name)
+      : name_(name), start_ns_(Tracer::Get().enabled() ? Tracer::Now() : -1) {}
+  ~TraceSpan() {
+    if (start_ns_ >= 0) {
+      Tracer::Get().Record(name_, start_ns_, Tracer::Now());
+    }
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  const char* name_;
+  int64_t start_ns_;
+};
+
+}  // namespace render
@@ -1,8 +1,10 @@
 #include "render/cuda/cuda_renderer.h"
 
+#include <chrono>
 #include <stdexcept>
 
 #include "render/common/coloring.h"
+#include "render/common/cone_march.h"
 #include "render/common/fractals.h"
 #include "render/common/utils.h"
 #include "render/cuda/utils.h"
@@ -18,6 +20,10 @@ namespace {
 constexpr int kMaxSteps = 1000;
 constexpr float kEpsilon = 0.001f;
 constexpr float kMaxDistance = 10.0f;
+// The cone pre-pass marches one cone per square block of kConeBlock pixels
+// for at most kConeSteps steps.
+constexpr int kConeBlock = 8;
+constexpr int kConeSteps = 32;
 
 __global__ void Render2DKernel(cudaSurfaceObject_t surf, int w, int h,
                                render::RenderSettings settings) {
@@ -45,8 +51,33 @@ __global__ void Render2DKernel(cudaSurfaceObject_t surf, int w, int h,
   surf2Dwrite(c, surf, x * sizeof(Color), y, cudaBoundaryModeTrap);
 }
 
+// Writes the distance every ray of each cone block may start at, or -1 for
+// blocks whose cone escapes.
+template <render::FractalType kType>
+__global__ void ConeMarchKernel(float* cone_t, int cones_x, int cones_y,
+                                int w, int h,
+                                render::RenderSettings settings) {
+  int cx = blockIdx.x * blockDim.x + threadIdx.x;
+  int cy = blockIdx.y * blockDim.y + threadIdx.y;
+
+  if (cx >= cones_x || cy >= cones_y) return;
+
+  const int x0 = cx * kConeBlock;
+  const int y0 = cy * kConeBlock;
+  const auto cone =
+      render::MakeCone(x0, y0, min(x0 + kConeBlock, w),
+                       min(y0 + kConeBlock, h), w, h, settings.camera);
+
+  bool escaped;
+  const float t = render::ConeMarch<kType>(
+      cone, 0.0f, settings.fractal, kConeSteps, kMaxDistance, &escaped);
+  cone_t[cy * cones_x + cx] = escaped ? -1.0f : t;
+}
+
+template <render::FractalType kType>
 __global__ void RayMarchingKernel(cudaSurfaceObject_t surf, int w, int h,
-                                  render::RenderSettings settings) {
+                                  render::RenderSettings settings,
+                                  const float* cone_t, int cones_x) {
   int idx = blockIdx.x * blockDim.x + threadIdx.x;
   int idy = blockIdx.y * blockDim.y + threadIdx.y;
 
@@ -58,15 +89,35 @@ __global__ void RayMarchingKernel(cudaSurfaceObject_t surf, int w, int h,
       const auto ray = MakeRay(x, y, w, h, settings.camera);
       Color color = {0, 0, 0, 255};
 
-      float t = 0.0f;
+      // Negative for blocks whose cone escaped: skip the march.
+      float t = cone_t[(y / kConeBlock) * cones_x + x / kConeBlock];
+      const int steps = t < 0.0f ? 0 : kMaxSteps;
+      if (steps == 0) {
+        color = {100, 100, 100, 255};
+      }
 
-      for (int i = 0; i < kMaxSteps; ++i) {
+      // Over-relaxed, less after each overshoot, as in MarchPacket.
+      float relaxation = settings.relaxation;
+      float radius = 0.0f;
+      float stride = 0.0f;
+      for (int i = 0; i < steps; ++i) {
         const auto pos = ray.position + ray.direction * t;
-        const auto distance = render::CalculateSignedDistance(pos, settings);
+        // The trap of the step that hits colors the pixel.
+        float trap = 0.0f;
+        const auto distance =
+            render::SignedDistance<kType>(pos, settings.fractal, &trap);
+
+        if (relaxation > 1.0f && stride > 0.0f &&
+            (distance < 0.0f || distance + radius < stride)) {
+          t -= stride - radius;
+          relaxation = 1.0f + (relaxation - 1.0f) * 0.5f;
+          stride = 0.0f;
+          continue;
+        }
 
         if (distance < kEpsilon * t) {
-          const auto n = render::GetNormal(pos, settings);
-          color = render::GetFractalColor(pos, n, settings.fractal);
+          const auto n = render::GetNormal<kType>(pos, settings.fractal);
+          color = render::GetFractalColor(pos, n, trap, settings.fractal);
           color = render::Lighting(color, pos, n, settings);
           break;
         }
@@ -75,7 +126,9 @@ __global__ void RayMarchingKernel(cudaSurfaceObject_t surf, int w, int h,
           color = {100, 100, 100, 255};
           break;
         }
-        t += distance;
+        radius = distance;
+        stride = distance * relaxation;
+        t += stride;
       }
 
       uchar4 c = {color.r, color.g, color.b, color.a};
@@ -90,7 +143,11 @@ namespace render {
 
 CUDARenderer::CUDARenderer() = default;
 
-CUDARenderer::~CUDARenderer() = default;
+CUDARenderer::~CUDARenderer() {
+  if (cone_t_) {
+    cudaFree(cone_t_);
+  }
+}
 
 void CUDARenderer::Init(uint32_t target_tex_id) {
   if (initialized_) {
@@ -110,11 +167,23 @@ void CUDARenderer::Init(uint32_t target_tex_id) {
 void CUDARenderer::Resize(uint32_t width, uint32_t height) {
   width_ = width;
   height_ = height;
+
+  if (cone_t_) {
+    CUDA_CHECK(cudaFree(cone_t_));
+    cone_t_ = nullptr;
+  }
+  const size_t cones = static_cast<size_t>((width + kConeBlock - 1) /
+                                           kConeBlock) *
+                       ((height + kConeBlock - 1) / kConeBlock);
+  if (cones > 0) {
+    CUDA_CHECK(cudaMalloc(&cone_t_, cones * sizeof(float)));
+  }
 }
 
 void CUDARenderer::Render() {
   if (!initialized_ || width_ == 0 || height_ == 0) return;
 
+  const auto start = std::chrono::steady_clock::now();
   cudaGraphicsResource_t temp_resource = nullptr;
   CUDA_CHECK(
       cudaGraphicsGLRegisterImage(&temp_resource, gl_tex_id_, GL_TEXTURE_2D,
@@ -137,12 +206,22 @@ void CUDARenderer::Render() {
   dim3 grid((width_ + block.x - 1) / block.x,
             (height_ + block.y - 1) / block.y);
 
-  if (Is2DFractal(settings_provider_->GetSettings().fractal.type)) {
-    Render2DKernel<<<grid, block>>>(surf, width_, height_,
-                                    settings_provider_->GetSettings());
+  const auto settings = settings_provider_->GetSettings();
+  if (Is2DFractal(settings.fractal.type)) {
+    Render2DKernel<<<grid, block>>>(surf, width_, height_, settings);
   } else {
-    RayMarchingKernel<<<grid, dim3(16, 16)>>>(
-        surf, width_, height_, settings_provider_->GetSettings());
+    const int cones_x = (width_ + kConeBlock - 1) / kConeBlock;
+    const int cones_y = (height_ + kConeBlock - 1) / kConeBlock;
+    dim3 cone_grid((cones_x + block.x - 1) / block.x,
+                   (cones_y + block.y - 1) / block.y);
+    // One kernel pair per fractal type, each with its SDF inlined.
+    DispatchFractal3D(settings.fractal.type, [&](auto type) {
+      constexpr FractalType kType = decltype(type)::value;
+      ConeMarchKernel<kType><<<cone_grid, block>>>(
+          cone_t_, cones_x, cones_y, width_, height_, settings);
+      RayMarchingKernel<kType><<<grid, dim3(16, 16)>>>(
+          surf, width_, height_, settings, cone_t_, cones_x);
+    });
   }
   CUDA_CHECK(cudaGetLastError());
   CUDA_CHECK(cudaDeviceSynchronize());
@@ -152,6 +231,20 @@ void CUDARenderer::Render() {
   CUDA_CHECK(cudaGraphicsUnregisterResource(temp_resource));
 
   glFlush();
+
+  const auto end = std::chrono::steady_clock::now();
+  frame_ms_ = std::chrono::duration<double, std::milli>(end - start).count();
+  rendered_ = true;
+}
+
+bool CUDARenderer::Present(FrameStats* stats) {
+  if (!rendered_) {
+    return false;
+  }
+  rendered_ = false;
+  *stats = FrameStats{};
+  stats->render_ms = frame_ms_;
+  return true;
 }
 
 void CUDARenderer::SetSettingsProvider(SettingsProvider* settings) {
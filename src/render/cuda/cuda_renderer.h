@@ -14,6 +14,7 @@ class CUDARenderer : public Renderer {
   void Init(uint32_t target_tex_id) override;
   void Resize(uint32_t w, uint32_t h) override;
   void Render() override;
+  bool Present(FrameStats* stats) override;
   void SetSettingsProvider(SettingsProvider* settings) override;
 
  private:
@@ -24,7 +25,14 @@ class CUDARenderer : public Renderer {
 
   uint32_t gl_tex_id_ = 0;
 
+  // Per cone block start distance of the 3D pre-pass, in device memory.
+  float* cone_t_ = nullptr;
+
   bool initialized_ = false;
+
+  // Render draws into the texture directly; Present only reports the frame.
+  bool rendered_ = false;
+  double frame_ms_ = 0.0;
 };
 
 }  // namespace render
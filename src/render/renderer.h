@@ -1,16 +1,37 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 
 #include "render/settings_provider.h"
 
 namespace render {
 
+struct FrameStats {
+  // Time the frame took to render.
+  double render_ms = 0.0;
+  // Whether the frame shows a heatmap, and its per-pixel cost percentiles.
+  bool heatmap = false;
+  uint32_t cost_p50 = 0;
+  uint32_t cost_p99 = 0;
+};
+
 class Renderer {
  public:
+  virtual ~Renderer() = default;
+
   virtual void Init(uint32_t target_tex_id) = 0;
   virtual void Resize(uint32_t w, uint32_t h) = 0;
+  // Renders a frame with the provider's current settings into the target
+  // texture. Renderers with their own render thread only request it here.
   virtual void Render() = 0;
+  // Called on the GL thread before every draw. Returns true if the target
+  // texture holds a frame it did not hold at the last call, and sets its
+  // stats.
+  virtual bool Present(FrameStats* stats) = 0;
+  // Renderers with their own render thread call `callback` from it whenever
+  // a frame is ready to be presented.
+  virtual void SetFrameReadyCallback(std::function<void()> /*callback*/) {}
 
   virtual void SetSettingsProvider(SettingsProvider* settings) = 0;
 };
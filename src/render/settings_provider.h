@@ -2,6 +2,7 @@
 
 #include <cstdint>
 
+#include "render/common/fixed_point.h"
 #include "render/common/types.h"
 
 namespace render {
@@ -53,9 +54,42 @@ struct CameraSettings {
   float aspect = 1.0f;
 };
 
+// High-precision view of the 2D plane. SettingsManager keeps it in step with
+// camera.position and camera.scale for 2D fractals; the CPU renderer reads
+// it instead, since a float camera breaks up into blocks near 1e-6.
+struct View2DSettings {
+  // FixedPoint resolves about 1e-125, which leaves a few digits for pixels.
+  static constexpr double kMinScale = 1e-110;
+
+  // Defaults match CameraSettings.
+  FixedPoint center_x;
+  FixedPoint center_y = FixedPoint::FromInt(-2);
+  double scale = 1.0;
+
+  // Render the Mandelbrot set by perturbation around reference orbits even
+  // where double-double would still do.
+  bool deep_zoom = false;
+};
+
+// What the CPU renderer writes instead of colors, to show where a frame's
+// work goes. Costs are mapped to a heatmap scaled to the frame's 99th
+// percentile.
+enum class Heatmap : uint8_t {
+  kOff,
+  // Escape iterations of 2D pixels, march steps of 3D rays.
+  kSteps,
+  // SDF evaluations of 3D rays: march steps plus the normal's samples. 2D
+  // pixels show escape iterations as with kSteps.
+  kEvaluations,
+};
+
 struct RenderSettings {
   CameraSettings camera;
   FractalSettings fractal;
+  View2DSettings view2d;
+  Heatmap heatmap = Heatmap::kOff;
+  // Over-relaxation factor of 3D sphere tracing, in [1, 2); see MarchLimits.
+  float relaxation = 1.0f;
 };
 
 class SettingsProvider {